@@ -1,9 +1,31 @@
 #include <iostream>
 #include <vector>
 #include <limits>
-#include <random>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <memory>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 enum class Player {
     BLUE,
@@ -15,13 +37,26 @@ enum class BluePath {
     TOP_TO_BOTTOM
 };
 
+// Offsets (dx, dy) of the six neighbours of a hex cell
+static const int hexDirections[6][2] = {{-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}};
+
 class Board {
 private:
     int size;
     std::vector<std::vector<int>> grid;
+    std::vector<int> journal; // cells placed with placeStone, newest last, so a scratch board can roll back
+    int stones;
 
 public:
-    Board(int size) : size(size), grid(size, std::vector<int>(size, 0)) {}
+    Board(int size) : size(size), grid(size, std::vector<int>(size, 0)), stones(0) {}
+
+    int getSize() const {
+        return size;
+    }
+
+    int getCell(int x, int y) const {
+        return grid[x][y];
+    }
 
     bool isValidMove(int x, int y) const {
         return x >= 0 && x < size && y >= 0 && y < size && grid[x][y] == 0;
@@ -29,6 +64,31 @@ public:
 
     void makeMove(int x, int y, Player player) {
         grid[x][y] = (player == Player::BLUE) ? 1 : 2;
+        ++stones;
+    }
+
+    // Search move, recorded in the journal
+    void placeStone(int x, int y, Player player) {
+        grid[x][y] = (player == Player::BLUE) ? 1 : 2;
+        journal.push_back(x * size + y);
+        ++stones;
+    }
+
+    int stonesPlaced() const {
+        return stones;
+    }
+
+    size_t journalMark() const {
+        return journal.size();
+    }
+
+    // Takes back every stone placed since `mark`, newest first
+    void rollback(size_t mark) {
+        while (journal.size() > mark) {
+            grid[journal.back() / size][journal.back() % size] = 0;
+            journal.pop_back();
+            --stones;
+        }
     }
 
     bool isTerminal() const {
@@ -44,164 +104,1126 @@ public:
     }
 
     bool hasWinner(Player player, BluePath bluePath) const {
-        // Implement your winning condition based on the game rules
+        // BLUE joins the edges named by bluePath and RED the other pair; search outward from the first edge
+        // The visit stamps and the frontier are per thread and keep their capacity, so playouts allocate nothing here
+        thread_local std::vector<unsigned> visited; // cell -> stamp of the last check that reached it
+        thread_local std::vector<int> frontier;
+        thread_local unsigned stamp = 0;
+        if (static_cast<int>(visited.size()) < size * size) visited.assign(size * size, 0);
+        if (++stamp == 0) {
+            std::fill(visited.begin(), visited.end(), 0);
+            stamp = 1;
+        }
+        frontier.clear();
+        const int stone = (player == Player::BLUE) ? 1 : 2;
+        const bool acrossColumns = (player == Player::BLUE) == (bluePath == BluePath::LEFT_TO_RIGHT);
+
+        for (int k = 0; k < size; ++k) {
+            int x = acrossColumns ? k : 0;
+            int y = acrossColumns ? 0 : k;
+            if (grid[x][y] == stone) {
+                visited[x * size + y] = stamp;
+                frontier.push_back(x * size + y);
+            }
+        }
+        while (!frontier.empty()) {
+            int x = frontier.back() / size;
+            int y = frontier.back() % size;
+            frontier.pop_back();
+            if ((acrossColumns ? y : x) == size - 1) {
+                return true;
+            }
+            for (const auto& direction : hexDirections) {
+                int nx = x + direction[0];
+                int ny = y + direction[1];
+                if (nx >= 0 && nx < size && ny >= 0 && ny < size && visited[nx * size + ny] != stamp &&
+                    grid[nx][ny] == stone) {
+                    visited[nx * size + ny] = stamp;
+                    frontier.push_back(nx * size + ny);
+                }
+            }
+        }
         return false;
     }
 
     std::vector<std::pair<int, int>> getLegalMoves() const {
         std::vector<std::pair<int, int>> legalMoves;
+        listLegalMoves(legalMoves);
+        return legalMoves;
+    }
+
+    // Fills `moves` (reusing its storage) with the empty cells
+    void listLegalMoves(std::vector<std::pair<int, int>>& moves) const {
+        moves.clear();
         for (int i = 0; i < size; ++i) {
             for (int j = 0; j < size; ++j) {
                 if (grid[i][j] == 0) {
-                    legalMoves.push_back({i, j});
+                    moves.push_back({i, j});
                 }
             }
         }
-        return legalMoves;
     }
 
+    // Builds the whole frame first and writes it at once
     void display() const {
+        std::string frame;
+        frame.reserve(size * (2 * size + 1));
         for (int i = 0; i < size; ++i) {
             for (int j = 0; j < size; ++j) {
                 if (grid[i][j] == 0) {
-                    std::cout << "- ";
+                    frame += "- ";
                 } else if (grid[i][j] == 1) {
-                    std::cout << "B ";
+                    frame += "B ";
                 } else {
-                    std::cout << "R ";
+                    frame += "R ";
                 }
             }
-            std::cout << std::endl;
+            frame += '\n';
+        }
+        std::cout.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+        std::cout.flush();
+    }
+};
+
+//Random Number Layer: small-state playout generator plus counter-based streams
+//splitmix64 finaliser, used to expand a 64-bit seed into generator state
+inline std::uint64_t splitMix64(std::uint64_t& state) {
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// xoroshiro128+ : 16 bytes of state, a few cycles per draw (mt19937 carries 2.5 KB)
+class Xoroshiro128Plus {
+private:
+    std::uint64_t s0, s1;
+
+    static std::uint64_t rotl(std::uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+public:
+    using result_type = std::uint64_t;
+
+    explicit Xoroshiro128Plus(std::uint64_t seed = 0) {
+        this->seed(seed);
+    }
+
+    Xoroshiro128Plus(std::uint64_t a, std::uint64_t b) : s0(a), s1(b) {
+        if (s0 == 0 && s1 == 0) s1 = 1; // the all-zero state is a fixed point
+    }
+
+    void seed(std::uint64_t seed) {
+        s0 = splitMix64(seed);
+        s1 = splitMix64(seed);
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type(0); }
+
+    result_type operator()() {
+        const std::uint64_t a = s0;
+        std::uint64_t b = s1;
+        const std::uint64_t result = a + b;
+        b ^= a;
+        s0 = rotl(a, 24) ^ b ^ (b << 16);
+        s1 = rotl(b, 37);
+        return result;
+    }
+
+    // Unbiased value in [0, bound) using Lemire's multiply-shift rejection
+    std::uint32_t bounded(std::uint32_t bound) {
+        std::uint64_t m = static_cast<std::uint64_t>(static_cast<std::uint32_t>((*this)() >> 32)) * bound;
+        std::uint32_t low = static_cast<std::uint32_t>(m);
+        if (low < bound) {
+            const std::uint32_t threshold = static_cast<std::uint32_t>(-bound) % bound;
+            while (low < threshold) {
+                m = static_cast<std::uint64_t>(static_cast<std::uint32_t>((*this)() >> 32)) * bound;
+                low = static_cast<std::uint32_t>(m);
+            }
+        }
+        return static_cast<std::uint32_t>(m >> 32);
+    }
+};
+
+// Philox4x32-10 counter-based generator: output block = f(key, counter), no hidden state,
+// so any stream position can be reached directly regardless of which thread asks for it
+class Philox4x32 {
+public:
+    struct Block {
+        std::uint32_t v[4];
+    };
+
+    static Block generate(std::uint64_t key, Block counter) {
+        std::uint32_t k0 = static_cast<std::uint32_t>(key);
+        std::uint32_t k1 = static_cast<std::uint32_t>(key >> 32);
+        for (int round = 0; round < 10; ++round) {
+            const std::uint64_t p0 = static_cast<std::uint64_t>(0xD2511F53u) * counter.v[0];
+            const std::uint64_t p1 = static_cast<std::uint64_t>(0xCD9E8D57u) * counter.v[2];
+            counter = Block{{static_cast<std::uint32_t>(p1 >> 32) ^ counter.v[1] ^ k0,
+                             static_cast<std::uint32_t>(p1),
+                             static_cast<std::uint32_t>(p0 >> 32) ^ counter.v[3] ^ k1,
+                             static_cast<std::uint32_t>(p0)}};
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        return counter;
+    }
+};
+
+// Reproducible random streams keyed by (seed, move, trial): the same key always yields the same
+// playout generator, no matter how many threads run the trials or in which order
+class RandomStreams {
+private:
+    std::uint64_t seed;
+
+public:
+    explicit RandomStreams(std::uint64_t seed) : seed(seed) {}
+
+    std::uint64_t getSeed() const {
+        return seed;
+    }
+
+    // ply = stones on the board, candidate = index of the evaluated move, trial = playout number
+    Xoroshiro128Plus stream(std::uint32_t ply, std::uint32_t candidate, std::uint32_t trial) const {
+        Philox4x32::Block block = Philox4x32::generate(seed, Philox4x32::Block{{trial, candidate, ply, 0}});
+        return Xoroshiro128Plus((static_cast<std::uint64_t>(block.v[0]) << 32) | block.v[1],
+                                (static_cast<std::uint64_t>(block.v[2]) << 32) | block.v[3]);
+    }
+
+    static std::uint64_t clockSeed() {
+        return static_cast<std::uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+    }
+};
+
+// Fisher-Yates shuffle with our own bounded draws so a seed replays identically on every standard library
+template <typename T>
+void shuffleWith(std::vector<T>& items, Xoroshiro128Plus& rng) {
+    for (std::size_t i = items.size(); i > 1; --i) {
+        std::size_t j = rng.bounded(static_cast<std::uint32_t>(i));
+        std::swap(items[i - 1], items[j]);
+    }
+}
+
+//UCB1 selection kernel over one node's children, stored as parallel arrays
+// The parent log term is computed once per selection; the per-child square roots and divisions run in SIMD lanes.
+// Returns the index of the best child, or the first unvisited one; children with a proof are never chosen, and -1
+// means every child has one.
+inline int selectUCB1(const std::atomic<int>* visits, const std::atomic<int>* wins, const std::atomic<int>* pending,
+                      const std::atomic<int>* proofs, int count, int parentVisits, float C) {
+    thread_local std::vector<float> n, w, score;
+    n.resize(count);
+    w.resize(count);
+    score.resize(count);
+    for (int i = 0; i < count; ++i) {
+        int v = visits[i].load(std::memory_order_relaxed) + pending[i].load(std::memory_order_relaxed);
+        if (v == 0 && proofs[i].load(std::memory_order_relaxed) == 0) {
+            return i; // unvisited children are tried first
+        }
+        n[i] = static_cast<float>(std::max(1, v));
+        w[i] = static_cast<float>(wins[i].load(std::memory_order_relaxed));
+    }
+    const float logParent = std::log(static_cast<float>(std::max(1, parentVisits)));
+
+    int i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128 cLanes = _mm_set1_ps(C);
+    const __m128 logLanes = _mm_set1_ps(logParent);
+    for (; i + 4 <= count; i += 4) {
+        __m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), _mm_loadu_ps(&n[i]));
+        __m128 exploit = _mm_mul_ps(_mm_loadu_ps(&w[i]), inverse);
+        __m128 explore = _mm_mul_ps(cLanes, _mm_sqrt_ps(_mm_mul_ps(logLanes, inverse)));
+        _mm_storeu_ps(&score[i], _mm_add_ps(exploit, explore));
+    }
+#endif
+    for (; i < count; ++i) {
+        float inverse = 1.0f / n[i];
+        score[i] = w[i] * inverse + C * std::sqrt(logParent * inverse);
+    }
+
+    int best = -1;
+    for (int k = 0; k < count; ++k) {
+        if (proofs[k].load(std::memory_order_relaxed) == 0 && (best < 0 || score[k] > score[best])) {
+            best = k;
+        }
+    }
+    return best;
+}
+
+//Perfect Play: read-only view of the tables written by Advance_Hex_Game --solve
+// Same file layout: header, open-addressed key slots (key + 1, 0 = empty), then one info byte per slot (bit 7: side to
+// move wins, bits 0-5: best cell in the canonical frame where BLUE joins the left and right edges)
+class MappedFile {
+private:
+    const unsigned char* base;
+    std::size_t length;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+
+public:
+    explicit MappedFile(const std::string& path) : base(nullptr), length(0) {
+#ifdef _WIN32
+        mapping = nullptr;
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) return;
+        length = static_cast<std::size_t>(fileSize.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) return;
+        base = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) return;
+        length = static_cast<std::size_t>(st.st_size);
+        void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED) return;
+        base = static_cast<const unsigned char*>(view);
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (base) UnmapViewOfFile(base);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+        if (base) munmap(const_cast<unsigned char*>(base), length);
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const {
+        return base;
+    }
+
+    std::size_t size() const {
+        return base ? length : 0;
+    }
+};
+
+struct PerfectTableHeader {
+    char magic[4];       // "HEXT"
+    std::uint8_t version;
+    std::uint8_t boardSize;
+    std::uint16_t maxStones;
+    std::uint32_t reserved;
+    std::uint64_t slotCount; // power of two
+    std::uint64_t entryCount;
+};
+static_assert(sizeof(PerfectTableHeader) == 32, "PerfectTableHeader must stay 32 bytes");
+
+class PerfectPlayTable {
+private:
+    MappedFile file;
+    const PerfectTableHeader* header;
+    const std::uint64_t* keys;
+    const std::uint8_t* info;
+
+public:
+    explicit PerfectPlayTable(const std::string& path) : file(path), header(nullptr), keys(nullptr), info(nullptr) {
+        if (file.size() < sizeof(PerfectTableHeader)) return;
+        const PerfectTableHeader* candidate = reinterpret_cast<const PerfectTableHeader*>(file.data());
+        if (std::memcmp(candidate->magic, "HEXT", 4) != 0 || candidate->version != 1 ||
+            file.size() < sizeof(PerfectTableHeader) + candidate->slotCount * 9) {
+            return;
+        }
+        header = candidate;
+        keys = reinterpret_cast<const std::uint64_t*>(file.data() + sizeof(PerfectTableHeader));
+        info = file.data() + sizeof(PerfectTableHeader) + header->slotCount * sizeof(std::uint64_t);
+    }
+
+    bool isOpen() const {
+        return header != nullptr;
+    }
+
+    // Looks the position up; on success sets whether the side to move wins and a best move in board coordinates
+    bool lookup(const Board& board, BluePath bluePath, bool& toMoveWins, std::pair<int, int>& best) const {
+        const int size = board.getSize();
+        if (header == nullptr || size != header->boardSize) return false;
+        // Base-3 key over canonical cells (0 empty, 1 BLUE, 2 RED), minimised over the 180 degree rotation
+        const int cells = size * size;
+        std::vector<int> digits(cells);
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                int cell = (bluePath == BluePath::LEFT_TO_RIGHT) ? x * size + y : y * size + x;
+                digits[cell] = board.getCell(x, y);
+            }
+        }
+        std::uint64_t plain = 0, turned = 0;
+        for (int i = cells - 1; i >= 0; --i) plain = plain * 3 + digits[i];
+        for (int i = 0; i < cells; ++i) turned = turned * 3 + digits[i];
+        const bool rotated = turned < plain;
+        const std::uint64_t key = rotated ? turned : plain;
+
+        const std::uint64_t mask = header->slotCount - 1;
+        for (std::uint64_t slot = ((key + 1) * 0x9E3779B97F4A7C15ULL >> 17) & mask;; slot = (slot + 1) & mask) {
+            if (keys[slot] == 0) return false;
+            if (keys[slot] == key + 1) {
+                int cell = info[slot] & 0x3F;
+                if (rotated) cell = cells - 1 - cell;
+                best = (bluePath == BluePath::LEFT_TO_RIGHT) ? std::make_pair(cell / size, cell % size)
+                                                             : std::make_pair(cell % size, cell / size);
+                toMoveWins = (info[slot] & 0x80) != 0;
+                return true;
+            }
         }
     }
 };
 
+//Move Priors: read-only view of the pattern tables written by Advance_Hex_Game --train-priors
+// Same features: the six neighbours seen by the mover in the frame where it joins the left and right edges (merged
+// with the 180 degree rotation), the bridge status of the cell and its distance to the nearer own edge
+struct PatternPriorsHeader {
+    char magic[4];              // "HEXP"
+    std::uint8_t version;
+    std::uint8_t reserved[3];
+    std::uint32_t featureCount;
+    std::uint32_t games;
+    std::uint32_t iterations;
+    std::uint32_t reservedWord;
+    std::uint64_t positions;
+};
+static_assert(sizeof(PatternPriorsHeader) == 32, "PatternPriorsHeader must stay 32 bytes");
+
+class PatternPriors {
+public:
+    static const int featureCount = 729 * 4 * 4; // neighbour patterns x bridge states x edge buckets
+
+private:
+    MappedFile file;
+    const float* weights;
+
+public:
+    explicit PatternPriors(const std::string& path) : file(path), weights(nullptr) {
+        if (file.size() < sizeof(PatternPriorsHeader)) return;
+        const PatternPriorsHeader* header = reinterpret_cast<const PatternPriorsHeader*>(file.data());
+        if (std::memcmp(header->magic, "HEXP", 4) != 0 || header->version != 1 ||
+            header->featureCount != static_cast<std::uint32_t>(featureCount) ||
+            file.size() < sizeof(PatternPriorsHeader) + featureCount * sizeof(float)) {
+            return;
+        }
+        weights = reinterpret_cast<const float*>(file.data() + sizeof(PatternPriorsHeader));
+    }
+
+    bool isOpen() const {
+        return weights != nullptr;
+    }
+
+    // Strength of the move at (x, y) for `mover`; an average move weighs about 1
+    float prior(const Board& board, BluePath bluePath, Player mover, int x, int y) const {
+        static const int ring[6][2] = {{-1, 0}, {-1, 1}, {0, 1}, {1, 0}, {1, -1}, {0, -1}}; // in order around a cell
+        const int size = board.getSize();
+        const int own = (mover == Player::BLUE) ? 1 : 2;
+        const bool acrossColumns = (mover == Player::BLUE) == (bluePath == BluePath::LEFT_TO_RIGHT);
+        // 0 empty, 1 own, 2 opponent; beyond an edge, the edge's owner
+        auto stateAt = [&](int cx, int cy) {
+            const bool outX = cx < 0 || cx >= size, outY = cy < 0 || cy >= size;
+            if (outX || outY) return (acrossColumns ? outY : outX) ? 1 : 2;
+            const int stone = board.getCell(cx, cy);
+            return stone == 0 ? 0 : stone == own ? 1 : 2;
+        };
+        int state[6];
+        for (int i = 0; i < 6; ++i) {
+            int dx = ring[i][0], dy = ring[i][1];
+            if (!acrossColumns) std::swap(dx, dy);
+            state[i] = stateAt(x + dx, y + dy);
+        }
+        int pattern = 0, rotated = 0;
+        for (int i = 5; i >= 0; --i) {
+            pattern = pattern * 3 + state[i];
+            rotated = rotated * 3 + state[(i + 3) % 6];
+        }
+        int bridge = 0; // 1 makes a bridge, 2 saves an intruded one, 3 intrudes the opponent's
+        for (int i = 0; i < 6; ++i) {
+            const int before = state[(i + 5) % 6], here = state[i], after = state[(i + 1) % 6];
+            if (before == 1 && after == 1 && here == 2) {
+                bridge = 2;
+                break;
+            }
+            if (before == 2 && after == 2 && here == 0) bridge = 3;
+            if (bridge == 0 && here == 0 && after == 0) {
+                int dx = ring[i][0] + ring[(i + 1) % 6][0], dy = ring[i][1] + ring[(i + 1) % 6][1];
+                if (!acrossColumns) std::swap(dx, dy);
+                const int fx = x + dx, fy = y + dy;
+                if (fx >= 0 && fx < size && fy >= 0 && fy < size && board.getCell(fx, fy) == own) bridge = 1;
+            }
+        }
+        const int line = acrossColumns ? y : x;
+        const int edge = std::min(3, std::min(line, size - 1 - line));
+        return weights[(std::min(pattern, rotated) * 4 + bridge) * 4 + edge];
+    }
+};
+
+//Search Settings: the engine constants that can be tuned, with a plain "name value" file format
+// Lines starting with '#' are comments. Unknown names are rejected so a typo does not silently keep a default.
+struct SearchSettings {
+    int simulations = 1000;   // playouts per move
+    int moveMillis = 0;       // also stop after this many milliseconds, 0 = playout budget only
+    float exploration = 1.0f; // UCB1 exploration constant
+    // Progressive widening: a node with N visits considers only its first base + alpha * N^beta children in prior
+    // order; base = 0 considers every child
+    int wideningBase = 0;
+    double wideningAlpha = 1.0;
+    double wideningBeta = 0.5;
+    int priorVisits = 8;      // virtual playouts a new edge starts with when priors are loaded
+    float priorReply = 3.0f;  // a playout answers next to the last move when a cell weighs this much
+    int batch = 1;            // leaves a search thread selects before playing them out
+    int leafPlayouts = 1;     // playouts run from each selected leaf
+
+    bool set(const std::string& name, double value) {
+        if (name == "simulations") simulations = std::max(1, static_cast<int>(std::lround(value)));
+        else if (name == "move-ms") moveMillis = std::max(0, static_cast<int>(std::lround(value)));
+        else if (name == "exploration") exploration = static_cast<float>(value);
+        else if (name == "widening-base") wideningBase = std::max(0, static_cast<int>(std::lround(value)));
+        else if (name == "widening-alpha") wideningAlpha = value;
+        else if (name == "widening-beta") wideningBeta = value;
+        else if (name == "prior-visits") priorVisits = std::max(0, static_cast<int>(std::lround(value)));
+        else if (name == "prior-reply") priorReply = static_cast<float>(value);
+        else if (name == "batch") batch = std::max(1, static_cast<int>(std::lround(value)));
+        else if (name == "leaf-playouts") leafPlayouts = std::max(1, static_cast<int>(std::lround(value)));
+        else return false;
+        return true;
+    }
+
+    double get(const std::string& name) const {
+        if (name == "simulations") return simulations;
+        if (name == "move-ms") return moveMillis;
+        if (name == "exploration") return exploration;
+        if (name == "widening-base") return wideningBase;
+        if (name == "widening-alpha") return wideningAlpha;
+        if (name == "widening-beta") return wideningBeta;
+        if (name == "prior-visits") return priorVisits;
+        if (name == "prior-reply") return priorReply;
+        if (name == "batch") return batch;
+        if (name == "leaf-playouts") return leafPlayouts;
+        return 0.0;
+    }
+
+    bool load(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) return false;
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string name;
+            double value;
+            if (!(fields >> name) || name[0] == '#') continue;
+            if (!(fields >> value) || !set(name, value)) {
+                std::cerr << "Bad setting in " << path << ": " << line << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool save(const std::string& path, const std::string& comment) const {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out) return false;
+        out << "# " << comment << '\n'
+            << "simulations " << simulations << '\n'
+            << "move-ms " << moveMillis << '\n'
+            << "exploration " << exploration << '\n'
+            << "widening-base " << wideningBase << '\n'
+            << "widening-alpha " << wideningAlpha << '\n'
+            << "widening-beta " << wideningBeta << '\n'
+            << "prior-visits " << priorVisits << '\n'
+            << "prior-reply " << priorReply << '\n'
+            << "batch " << batch << '\n'
+            << "leaf-playouts " << leafPlayouts << '\n';
+        return static_cast<bool>(out);
+    }
+};
+
 class AIPlayer {
 private:
     Player player;
     Player opponent;
-    std::mt19937 rng;
+    RandomStreams streams;
+    int threads; // search threads sharing one tree
+    struct Node;
+    // Node store: every node the engine ever allocated, and the ones currently free for reuse
+    std::vector<Node*> ownedNodes;
+    std::vector<Node*> freeNodes;
+    std::mutex poolMutex;
+    size_t nodeBudget;              // hard cap on live nodes, 0 = unlimited
+    size_t liveNodes;               // guarded by poolMutex
+    std::atomic<bool> poolExhausted; // an allocation was refused, workers should pause for pruning
+    bool treeFrozen;                // pruning could not free anything, no new nodes for this search
+    SearchSettings settings;
+    const PerfectPlayTable* table; // optional small-board oracle, not owned
+    const PatternPriors* priors;   // optional learned move weights, not owned
 
 public:
-    AIPlayer(Player player) : player(player), opponent(player == Player::BLUE ? Player::RED : Player::BLUE) {
-        rng.seed(std::chrono::system_clock::now().time_since_epoch().count());
+    AIPlayer(Player player, std::uint64_t seed = RandomStreams::clockSeed(), int threads = 1)
+        : player(player), opponent(player == Player::BLUE ? Player::RED : Player::BLUE), streams(seed),
+          threads(std::max(1, threads)), nodeBudget(0), liveNodes(0), poolExhausted(false), treeFrozen(false),
+          table(nullptr), priors(nullptr) {}
+
+    ~AIPlayer() {
+        for (Node* node : ownedNodes) {
+            delete node;
+        }
     }
 
+    AIPlayer(const AIPlayer&) = delete;
+    AIPlayer& operator=(const AIPlayer&) = delete;
+
     Player getPlayer() const {
         return player;
     }
 
-    std::pair<int, int> getBestMove(Board board, BluePath bluePath) {
-        Node* rootNode = new Node(board, bluePath, {-1, -1});
-        const int simulations = 1000;
+    std::uint64_t getSeed() const {
+        return streams.getSeed();
+    }
+
+    void setThreads(int count) {
+        threads = std::max(1, count);
+    }
 
-        for (int sim = 0; sim < simulations; ++sim) {
-            Node* selectedNode = selectNode(rootNode);
-            expandNode(selectedNode);
-            bool result = simulateGame(selectedNode);
-            backpropagate(selectedNode, result);
+    // Caps the tree at the given number of nodes (0 = unlimited)
+    void setNodeBudget(size_t nodes) {
+        nodeBudget = nodes;
+    }
+
+    // Caps the tree memory for a board size; a node costs the struct plus, once expanded, one array entry per move
+    void setMemoryBudget(size_t bytes, int boardSize) {
+        size_t perNode = sizeof(Node) + Node::bytesPerChild * boardSize * boardSize;
+        nodeBudget = std::max<size_t>(1, bytes / perNode);
+    }
+
+    void setSettings(const SearchSettings& searchSettings) {
+        settings = searchSettings;
+    }
+
+    const SearchSettings& getSettings() const {
+        return settings;
+    }
+
+    void setTable(const PerfectPlayTable* perfectTable) {
+        table = perfectTable;
+    }
+
+    void setPriors(const PatternPriors* table) {
+        priors = table;
+    }
+
+    std::pair<int, int> getBestMove(Board board, BluePath bluePath) {
+        bool toMoveWins;
+        std::pair<int, int> tableMove;
+        if (table != nullptr && table->lookup(board, bluePath, toMoveWins, tableMove)) {
+            return tableMove; // solved position, no search needed
         }
 
-        double bestUCB1Value = -std::numeric_limits<double>::infinity();
-        Node* bestChild = nullptr;
+        recycleAll();
+        Node* rootNode = acquireNode(true);
+        rootNode->reset(player);
+        const int size = board.getSize();
+        const std::uint32_t ply = static_cast<std::uint32_t>(size * size - board.getLegalMoves().size());
+        expandNode(rootNode, board, bluePath); // the root always lists its moves
 
-        for (Node* child : rootNode->children) {
-            double UCB1Value = child->UCB1Value();
-            if (UCB1Value > bestUCB1Value) {
-                bestUCB1Value = UCB1Value;
-                bestChild = child;
+        // Tree parallelism: every thread descends the same tree; simulation numbers are handed out from a shared
+        // counter so the playout streams stay the same whatever the thread count
+        std::atomic<int> nextSimulation(0);
+        std::atomic<bool> outOfTime(false);
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(settings.moveMillis);
+        const int leafPlayouts = std::max(1, settings.leafPlayouts);
+        // Pipelined: a worker gathers a batch of leaves (their pending visits steer later descents elsewhere), then
+        // plays every leaf out without touching the tree, then backs the whole batch up. Batch 1 with one playout per
+        // leaf is the plain select-simulate-backpropagate loop, with the same playout streams.
+        auto worker = [&]() {
+            std::vector<Leaf> batch(std::max(1, settings.batch));
+            Board scratch = board; // one copy per thread; each simulation is rolled back through the journal
+            const size_t mark = scratch.journalMark();
+            bool more = true;
+            while (more) {
+                size_t gathered = 0;
+                while (gathered < batch.size()) {
+                    if (poolExhausted.load(std::memory_order_relaxed) ||
+                        rootNode->proof.load(std::memory_order_relaxed) != 0) {
+                        more = false;
+                        break;
+                    }
+                    int sim = nextSimulation.fetch_add(leafPlayouts);
+                    if (sim >= settings.simulations) {
+                        more = false;
+                        break;
+                    }
+                    if (settings.moveMillis > 0 && (sim / leafPlayouts) % 64 == 0 &&
+                        std::chrono::steady_clock::now() >= deadline) {
+                        outOfTime.store(true);
+                        more = false;
+                        break;
+                    }
+                    Leaf& leaf = batch[gathered++];
+                    leaf.firstSimulation = sim;
+                    leaf.playouts = std::min(leafPlayouts, settings.simulations - sim);
+                    leaf.toMove = selectNode(rootNode, scratch, bluePath, leaf.path, leaf.decided, leaf.winner);
+                    scratch.rollback(mark);
+                }
+                for (size_t i = 0; i < gathered; ++i) {
+                    evaluateLeaf(batch[i], scratch, bluePath, ply);
+                    scratch.rollback(mark);
+                }
+                for (size_t i = 0; i < gathered; ++i) {
+                    backpropagate(rootNode, batch[i].path, batch[i].playouts, batch[i].blueWins);
+                }
+            }
+        };
+        // Workers stop when the node budget runs out; the tree is pruned while no one is inside it, then search resumes.
+        // A proven root ends the search early.
+        while (nextSimulation.load() < settings.simulations && !outOfTime.load() && rootNode->proof.load() == 0) {
+            std::vector<std::thread> helpers;
+            for (int t = 1; t < threads; ++t) {
+                helpers.emplace_back(worker);
+            }
+            worker();
+            for (std::thread& helper : helpers) {
+                helper.join();
+            }
+            if (poolExhausted.load()) {
+                pruneTree(rootNode);
+                poolExhausted.store(false);
             }
         }
 
-        std::pair<int, int> bestMove = bestChild->action;
-        delete rootNode;
-        return bestMove;
+        // A proven win if there is one, else the most visited move not proven to lose (any move once all of them
+        // are); with widening some children may never have been tried
+        int best = -1;
+        for (int i = 0; i < rootNode->childCount; ++i) {
+            int proof = rootNode->childProofs[i].load();
+            if (proof == PROVEN_WIN) return rootNode->childMoves[i];
+            if (proof == PROVEN_LOSS && rootNode->proof.load() != PROVEN_LOSS) continue;
+            if (best < 0 || rootNode->childVisits[i].load() > rootNode->childVisits[best].load()) {
+                best = i;
+            }
+        }
+        return rootNode->childMoves[std::max(0, best)];
     }
 
 private:
+    enum ExpansionState { UNEXPANDED, EXPANDING, EXPANDED };
+    // MCTS-solver marks: an edge is proven for the side that plays its move, a node for the side to move in it
+    enum Proof { UNPROVEN, PROVEN_WIN, PROVEN_LOSS };
+
+    // Nodes hold no board: each simulation replays the moves along its path on one scratch board
     struct Node {
-        Board board;
-        BluePath bluePath;
-        std::pair<int, int> action;
-        int N;
-        double Q;
-        std::vector<Node*> children;
-        Node* parent;
+        static const size_t bytesPerChild = sizeof(std::pair<int, int>) + sizeof(std::atomic<Node*>) +
+                                            4 * sizeof(std::atomic<int>);
 
-        Node(Board board, BluePath bluePath, std::pair<int, int> action)
-            : board(board), bluePath(bluePath), action(action), N(0), Q(0.0), parent(nullptr) {}
+        Player toMove;                // side to move in this node's position
+        std::atomic<int> N;           // playouts through this node
+        std::atomic<int> virtualLoss; // threads currently below this node
+        std::atomic<int> state;       // ExpansionState; the move list is published by the store of EXPANDED
+        std::atomic<int> proof;       // Proof for toMove; survives pruning, since the position stays decided
+        bool live;                    // false while the slot sits on the free list
 
-        ~Node() {
-            for (Node* child : children) {
-                delete child;
-            }
+        // Children as structure-of-arrays, sorted by prior: edge statistics sit contiguously so selection never
+        // touches child nodes, and a child node is only created the first time its edge is followed. Pending visits
+        // (virtual losses) count as losses, which steers concurrent threads into different branches.
+        int childCount;
+        int childCapacity;
+        std::unique_ptr<std::pair<int, int>[]> childMoves;
+        std::unique_ptr<std::atomic<Node*>[]> childNodes;
+        std::unique_ptr<std::atomic<int>[]> childVisits;
+        std::unique_ptr<std::atomic<int>[]> childWins; // wins for the side that plays the move
+        std::unique_ptr<std::atomic<int>[]> childPending;
+        std::unique_ptr<std::atomic<int>[]> childProofs; // Proof for the side that plays the move
+
+        Node() : toMove(Player::BLUE), N(0), virtualLoss(0), state(UNEXPANDED), proof(UNPROVEN), live(false),
+                 childCount(0), childCapacity(0) {}
+
+        void reset(Player side) {
+            toMove = side;
+            N.store(0, std::memory_order_relaxed);
+            virtualLoss.store(0, std::memory_order_relaxed);
+            state.store(UNEXPANDED, std::memory_order_relaxed);
+            proof.store(UNPROVEN, std::memory_order_relaxed);
+            childCount = 0;
         }
 
-        double UCB1Value() const {
-            const double C = 1.0;
-            return Q / static_cast<double>(N) + C * std::sqrt(std::log(parent->N) / static_cast<double>(N));
+        // Sizes the child arrays for `count` children, keeping the allocation when it is already big enough
+        void prepareChildren(int count) {
+            if (count > childCapacity) {
+                childMoves.reset(new std::pair<int, int>[count]);
+                childNodes.reset(new std::atomic<Node*>[count]);
+                childVisits.reset(new std::atomic<int>[count]);
+                childWins.reset(new std::atomic<int>[count]);
+                childPending.reset(new std::atomic<int>[count]);
+                childProofs.reset(new std::atomic<int>[count]);
+                childCapacity = count;
+            }
+            for (int i = 0; i < count; ++i) {
+                childNodes[i].store(nullptr, std::memory_order_relaxed);
+                childVisits[i].store(0, std::memory_order_relaxed);
+                childWins[i].store(0, std::memory_order_relaxed);
+                childPending[i].store(0, std::memory_order_relaxed);
+                childProofs[i].store(UNPROVEN, std::memory_order_relaxed);
+            }
+            childCount = count;
         }
     };
 
-    Node* selectNode(Node* node) {
-        while (!node->board.isTerminal()) {
-            if (node->children.empty()) {
-                return node;
-            } else {
-                node = UCB1Select(node);
+    struct PathStep {
+        Node* node;
+        int child;
+        Node* entered; // the child node this step added a virtual loss to; null when the path stopped at the edge
+    };
+
+    // A selected leaf waiting in a batch: the path that reaches it and, once evaluated, its playout results
+    struct Leaf {
+        std::vector<PathStep> path;
+        Player toMove;   // side to move at the leaf
+        bool decided;    // the game is already over there (or the leaf is proven)
+        Player winner;   // valid when decided
+        int firstSimulation;
+        int playouts;
+        int blueWins;
+    };
+
+    // Children a node may choose from at its current visit count
+    int consideredChildren(const Node* node) const {
+        if (settings.wideningBase == 0) {
+            return node->childCount;
+        }
+        int visits = node->N.load(std::memory_order_relaxed);
+        int width = settings.wideningBase +
+                    static_cast<int>(settings.wideningAlpha * std::pow(static_cast<double>(visits), settings.wideningBeta));
+        return std::min(node->childCount, width);
+    }
+
+    // Descends from the root, playing the path on `board`; stops at a node that was just expanded or created, or at
+    // an edge whose child could not be allocated. Returns the side to move in the reached position. When the game is
+    // already decided there (a winning move, or a proven node) `decided` is set and `winner` names the winner.
+    Player selectNode(Node* node, Board& board, BluePath bluePath, std::vector<PathStep>& path, bool& decided,
+                      Player& winner) {
+        path.clear();
+        decided = false;
+        winner = node->toMove;
+        Player toMove = node->toMove;
+        const int size = board.getSize();
+        while (true) {
+            int proof = node->proof.load(std::memory_order_relaxed);
+            if (proof != UNPROVEN) {
+                decided = true;
+                winner = proof == PROVEN_WIN ? toMove : (toMove == Player::BLUE ? Player::RED : Player::BLUE);
+                return toMove;
+            }
+            if (node->state.load(std::memory_order_acquire) != EXPANDED) {
+                expandNode(node, board, bluePath);
+                return toMove;
+            }
+            const int parentVisits = node->N.load(std::memory_order_relaxed) +
+                                     node->virtualLoss.load(std::memory_order_relaxed);
+            int child = selectUCB1(node->childVisits.get(), node->childWins.get(), node->childPending.get(),
+                                   node->childProofs.get(), consideredChildren(node), parentVisits, settings.exploration);
+            if (child < 0) {
+                // Every child in the widening window is proven (or the board is full): look past the window
+                child = selectUCB1(node->childVisits.get(), node->childWins.get(), node->childPending.get(),
+                                   node->childProofs.get(), node->childCount, parentVisits, settings.exploration);
+                if (child < 0) return toMove; // a playout settles it; the proofs reach this node on the way up
+            }
+            node->childPending[child].fetch_add(1, std::memory_order_relaxed);
+            path.push_back({node, child, nullptr});
+            board.placeStone(node->childMoves[child].first, node->childMoves[child].second, toMove);
+            // A winning chain needs `size` stones of the mover, so early positions skip the check
+            if (board.stonesPlaced() >= 2 * size - 1 && board.hasWinner(toMove, bluePath)) {
+                node->childProofs[child].store(PROVEN_WIN, std::memory_order_relaxed);
+                decided = true;
+                winner = toMove;
+                return toMove == Player::BLUE ? Player::RED : Player::BLUE;
             }
+            toMove = (toMove == Player::BLUE) ? Player::RED : Player::BLUE;
+
+            Node* next = node->childNodes[child].load(std::memory_order_acquire);
+            if (next == nullptr) {
+                next = createChild(node, child, toMove);
+                if (next == nullptr) {
+                    return toMove; // out of nodes: the edge itself is the leaf
+                }
+                next->virtualLoss.fetch_add(1, std::memory_order_relaxed);
+                path.back().entered = next;
+                return toMove;
+            }
+            next->virtualLoss.fetch_add(1, std::memory_order_relaxed);
+            path.back().entered = next;
+            node = next;
         }
-        return node;
+        return toMove;
     }
 
-    Node* UCB1Select(Node* node) {
-        double bestUCB1Value = -std::numeric_limits<double>::infinity();
-        Node* bestChild = nullptr;
+    // Lazily materialises the child behind an edge; a thread that loses the race returns its slot and uses the winner's
+    Node* createChild(Node* parent, int child, Player toMove) {
+        if (treeFrozen) {
+            return nullptr;
+        }
+        Node* slot = acquireNode(false);
+        if (slot == nullptr) {
+            poolExhausted.store(true, std::memory_order_relaxed);
+            return nullptr;
+        }
+        slot->reset(toMove);
+        Node* expected = nullptr;
+        if (parent->childNodes[child].compare_exchange_strong(expected, slot, std::memory_order_acq_rel)) {
+            return slot;
+        }
+        std::lock_guard<std::mutex> lock(poolMutex);
+        slot->live = false;
+        freeNodes.push_back(slot);
+        --liveNodes;
+        return expected;
+    }
 
-        for (Node* child : node->children) {
-            double UCB1Value = child->UCB1Value();
-            if (UCB1Value > bestUCB1Value) {
-                bestUCB1Value = UCB1Value;
-                bestChild = child;
+    // Lock-free expansion: the thread that wins the UNEXPANDED -> EXPANDING exchange lists the moves in prior order,
+    // the others simply run their playout from the leaf instead of waiting. No child nodes are created here. With
+    // learned priors the order follows the pattern weights, and each edge starts with settings.priorVisits virtual
+    // playouts won in proportion w / (w + 1), so strong patterns are tried first and weak ones need real wins to
+    // catch up.
+    void expandNode(Node* node, const Board& board, BluePath bluePath) {
+        int expected = UNEXPANDED;
+        if (!node->state.compare_exchange_strong(expected, EXPANDING, std::memory_order_acq_rel)) {
+            return;
+        }
+        std::vector<std::pair<int, int>> legalMoves = board.getLegalMoves();
+        std::vector<std::pair<double, int>> ranked;
+        for (size_t i = 0; i < legalMoves.size(); ++i) {
+            const int x = legalMoves[i].first, y = legalMoves[i].second;
+            const double prior = priors != nullptr ? priors->prior(board, bluePath, node->toMove, x, y)
+                                                   : movePrior(board, x, y);
+            ranked.push_back({-prior, static_cast<int>(i)});
+        }
+        std::stable_sort(ranked.begin(), ranked.end());
+        node->prepareChildren(static_cast<int>(legalMoves.size()));
+        for (size_t i = 0; i < ranked.size(); ++i) {
+            node->childMoves[i] = legalMoves[ranked[i].second];
+            if (priors != nullptr) {
+                const double weight = -ranked[i].first;
+                const int visits = settings.priorVisits;
+                node->childVisits[i].store(visits, std::memory_order_relaxed);
+                node->childWins[i].store(static_cast<int>(std::lround(visits * weight / (weight + 1.0))),
+                                         std::memory_order_relaxed);
+            }
+        }
+        node->state.store(EXPANDED, std::memory_order_release);
+    }
+
+    // Cheap prior used to order moves for widening: central cells and cells touching stones first
+    static double movePrior(const Board& board, int x, int y) {
+        const int size = board.getSize();
+        const double centre = (size - 1) / 2.0;
+        double dx = x - centre, dy = y - centre;
+        double distance = (std::fabs(dx) + std::fabs(dy) + std::fabs(dx + dy)) / 2.0; // hex distance
+        int touching = 0;
+        for (const auto& direction : hexDirections) {
+            int nx = x + direction[0], ny = y + direction[1];
+            if (nx >= 0 && nx < size && ny >= 0 && ny < size && board.getCell(nx, ny) != 0) {
+                ++touching;
+            }
+        }
+        return touching - distance;
+    }
+
+    // Takes one slot from the free list (allocating a new one as needed); nullptr if that would break the budget
+    Node* acquireNode(bool force) {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (!force && nodeBudget != 0 && liveNodes + 1 > nodeBudget) {
+            return nullptr;
+        }
+        Node* node;
+        if (!freeNodes.empty()) {
+            node = freeNodes.back();
+            freeNodes.pop_back();
+        } else {
+            node = new Node();
+            ownedNodes.push_back(node);
+        }
+        node->live = true;
+        ++liveNodes;
+        return node;
+    }
+
+    void releaseSubtree(Node* node) {
+        for (int i = 0; i < node->childCount; ++i) {
+            Node* child = node->childNodes[i].load(std::memory_order_relaxed);
+            if (child != nullptr) {
+                releaseSubtree(child);
             }
         }
+        node->childCount = 0;
+        node->live = false;
+        freeNodes.push_back(node);
+        --liveNodes;
+    }
 
-        return bestChild;
+    void recycleAll() {
+        freeNodes.clear();
+        for (Node* node : ownedNodes) {
+            node->live = false;
+            freeNodes.push_back(node);
+        }
+        liveNodes = 0;
+        treeFrozen = false;
     }
 
-    void expandNode(Node* node) {
-        std::vector<std::pair<int, int>> legalMoves = node->board.getLegalMoves();
-        for (const auto& move : legalMoves) {
-            Board newBoard = node->board;
-            newBoard.makeMove(move.first, move.second, player);
-            Node* newNode = new Node(newBoard, node->bluePath, move);
-            newNode->parent = node;
-            node->children.push_back(newNode);
+    // Collapses the least-visited subtrees back into leaves (keeping their statistics) until a quarter of the budget
+    // is free again; called only while no worker is running
+    void pruneTree(Node* root) {
+        std::vector<Node*> internal;
+        std::vector<Node*> stack;
+        auto pushChildren = [&stack](Node* node) {
+            for (int i = 0; i < node->childCount; ++i) {
+                Node* child = node->childNodes[i].load(std::memory_order_relaxed);
+                if (child != nullptr) {
+                    stack.push_back(child);
+                }
+            }
+        };
+        pushChildren(root);
+        while (!stack.empty()) {
+            Node* node = stack.back();
+            stack.pop_back();
+            if (node->childCount > 0) {
+                internal.push_back(node);
+                pushChildren(node);
+            }
+        }
+        std::sort(internal.begin(), internal.end(), [](const Node* a, const Node* b) { return a->N.load() < b->N.load(); });
+
+        const size_t target = nodeBudget - nodeBudget / 4;
+        const size_t before = liveNodes;
+        for (Node* node : internal) {
+            if (liveNodes <= target) break;
+            if (!node->live) continue; // already freed together with an ancestor
+            for (int i = 0; i < node->childCount; ++i) {
+                Node* child = node->childNodes[i].load(std::memory_order_relaxed);
+                if (child != nullptr) {
+                    releaseSubtree(child);
+                }
+            }
+            node->childCount = 0;
+            node->state.store(UNEXPANDED, std::memory_order_relaxed);
+        }
+        if (liveNodes == before) {
+            treeFrozen = true; // nothing left to prune: keep searching with playouts from the current leaves
         }
     }
 
-    bool simulateGame(Node* node) {
-        Board board = node->board;
-        Player currentPlayer = player;
+    // Random playout on the scratch board with alternating colours; a filled board has exactly one winner
+    // Fills the board in a random order (the same distribution as a uniform random move each turn) with journaled
+    // stones; the caller rolls them back. With priors, each stone is answered at its heaviest empty neighbour when
+    // that weighs at least settings.priorReply, and the shuffled order supplies the other moves.
+    Player simulateGame(Board& board, Player toMove, BluePath bluePath, Xoroshiro128Plus& rng) const {
+        thread_local std::vector<std::pair<int, int>> legalMoves; // keeps its capacity between playouts
+        board.listLegalMoves(legalMoves);
+        shuffleWith(legalMoves, rng);
 
-        while (!board.isTerminal()) {
-            std::vector<std::pair<int, int>> legalMoves = board.getLegalMoves();
-            std::uniform_int_distribution<int> dist(0, legalMoves.size() - 1);
-            std::pair<int, int> randomMove = legalMoves[dist(rng)];
-            board.makeMove(randomMove.first, randomMove.second, currentPlayer);
+        Player currentPlayer = toMove;
+        if (priors == nullptr) {
+            for (const std::pair<int, int>& move : legalMoves) {
+                board.placeStone(move.first, move.second, currentPlayer);
+                currentPlayer = (currentPlayer == player) ? opponent : player;
+            }
+            return board.hasWinner(player, bluePath) ? player : opponent;
+        }
+
+        size_t next = 0;
+        std::pair<int, int> answer(-1, -1);
+        while (true) {
+            std::pair<int, int> move = answer;
+            if (move.first < 0) {
+                while (next < legalMoves.size() && !board.isValidMove(legalMoves[next].first, legalMoves[next].second)) {
+                    ++next;
+                }
+                if (next == legalMoves.size()) break;
+                move = legalMoves[next++];
+            }
+            board.placeStone(move.first, move.second, currentPlayer);
             currentPlayer = (currentPlayer == player) ? opponent : player;
+            answer = {-1, -1};
+            float bestWeight = settings.priorReply;
+            for (const auto& direction : hexDirections) {
+                const int x = move.first + direction[0], y = move.second + direction[1];
+                if (!board.isValidMove(x, y)) continue;
+                const float weight = priors->prior(board, bluePath, currentPlayer, x, y);
+                if (weight >= bestWeight) {
+                    bestWeight = weight;
+                    answer = {x, y};
+                }
+            }
         }
+        return board.hasWinner(player, bluePath) ? player : opponent;
+    }
 
-        return board.hasWinner(player, node->bluePath);
+    // Replays the leaf's path on the scratch board (the caller rolls it back) and runs its playouts, simulation
+    // numbers firstSimulation onwards
+    void evaluateLeaf(Leaf& leaf, Board& board, BluePath bluePath, std::uint32_t ply) const {
+        if (leaf.decided) {
+            leaf.blueWins = leaf.winner == Player::BLUE ? leaf.playouts : 0;
+            return;
+        }
+        Player toMove = leaf.path.empty() ? player : leaf.path.front().node->toMove;
+        for (const PathStep& step : leaf.path) {
+            const std::pair<int, int>& move = step.node->childMoves[step.child];
+            board.placeStone(move.first, move.second, toMove);
+            toMove = (toMove == Player::BLUE) ? Player::RED : Player::BLUE;
+        }
+        leaf.blueWins = 0;
+        const size_t mark = board.journalMark();
+        for (int k = 0; k < leaf.playouts; ++k) {
+            Xoroshiro128Plus rng = streams.stream(ply, 0, static_cast<std::uint32_t>(leaf.firstSimulation + k));
+            leaf.blueWins += simulateGame(board, leaf.toMove, bluePath, rng) == Player::BLUE;
+            board.rollback(mark);
+        }
     }
 
-    void backpropagate(Node* node, bool result) {
-        while (node != nullptr) {
-            node->N++;
-            if (result) {
-                node->Q++;
+    // Each edge is scored for the side that played its move. Proofs travel up the path first: a node with a winning
+    // edge is won, which makes the edge into it lost; a node whose edges all lose is lost, which makes the edge into
+    // it won. `playouts` results, `blueWins` of them won by BLUE, go up together.
+    void backpropagate(Node* root, const std::vector<PathStep>& path, int playouts, int blueWins) {
+        for (size_t i = path.size(); i-- > 0;) {
+            Node* node = path[i].node;
+            int proof = node->childProofs[path[i].child].load(std::memory_order_relaxed);
+            Node* child = node->childNodes[path[i].child].load(std::memory_order_relaxed);
+            if (proof == UNPROVEN && child != nullptr && child->proof.load(std::memory_order_relaxed) != UNPROVEN) {
+                proof = child->proof.load(std::memory_order_relaxed) == PROVEN_WIN ? PROVEN_LOSS : PROVEN_WIN;
+                node->childProofs[path[i].child].store(proof, std::memory_order_relaxed);
+            }
+            if (proof == PROVEN_LOSS) {
+                for (int k = 0; k < node->childCount && proof == PROVEN_LOSS; ++k) {
+                    proof = node->childProofs[k].load(std::memory_order_relaxed);
+                }
+            }
+            if (proof == UNPROVEN) break;
+            node->proof.store(proof, std::memory_order_relaxed);
+            if (i > 0) {
+                path[i - 1].node->childProofs[path[i - 1].child].store(proof == PROVEN_WIN ? PROVEN_LOSS : PROVEN_WIN,
+                                                                      std::memory_order_relaxed);
+            }
+        }
+
+        root->N.fetch_add(playouts, std::memory_order_relaxed);
+        for (const PathStep& step : path) {
+            // Only the node selection entered: another thread may have filled the slot since
+            if (step.entered != nullptr) {
+                step.entered->N.fetch_add(playouts, std::memory_order_relaxed);
+                step.entered->virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+            }
+            step.node->childVisits[step.child].fetch_add(playouts, std::memory_order_relaxed);
+            step.node->childPending[step.child].fetch_sub(1, std::memory_order_relaxed);
+            const int wins = step.node->toMove == Player::BLUE ? blueWins : playouts - blueWins;
+            if (wins > 0) {
+                step.node->childWins[step.child].fetch_add(wins, std::memory_order_relaxed);
             }
-            node = node->parent;
         }
     }
 };
@@ -213,13 +1235,39 @@ private:
     BluePath bluePath;
 
 public:
-    AIGame(int size, Player userPlayer) : Board(size), aiPlayer(userPlayer == Player::BLUE ? Player::RED : Player::BLUE) {
+    AIGame(int size, Player userPlayer, std::uint64_t seed = RandomStreams::clockSeed())
+        : Board(size), aiPlayer(userPlayer == Player::BLUE ? Player::RED : Player::BLUE, seed) {
         currentPlayer = Player::BLUE;
+        std::cout << "AI seed: " << aiPlayer.getSeed() << std::endl;
         if (userPlayer == Player::RED) {
             askBluePath();
         }
     }
 
+    void setThreads(int count) {
+        aiPlayer.setThreads(count);
+    }
+
+    void setNodeBudget(size_t nodes) {
+        aiPlayer.setNodeBudget(nodes);
+    }
+
+    void setSettings(const SearchSettings& settings) {
+        aiPlayer.setSettings(settings);
+    }
+
+    void setMemoryBudget(size_t bytes) {
+        aiPlayer.setMemoryBudget(bytes, getSize());
+    }
+
+    void setTable(const PerfectPlayTable* table) {
+        aiPlayer.setTable(table);
+    }
+
+    void setPriors(const PatternPriors* priors) {
+        aiPlayer.setPriors(priors);
+    }
+
     void play() {
         int moveCount = 0;
         Player userPlayer = aiPlayer.getPlayer() == Player::BLUE ? Player::RED : Player::BLUE;
@@ -277,7 +1325,7 @@ public:
                 currentPlayer = (currentPlayer == Player::BLUE) ? Player::RED : Player::BLUE;
             }
 
-            if (moveCount == size * size) {
+            if (moveCount == getSize() * getSize()) {
                 display();
                 std::cout << "It's a draw!" << std::endl;
                 return;
@@ -308,12 +1356,256 @@ private:
     }
 };
 
-int main() {
+// Measures search throughput on an empty board for 1, 2, 4, ... threads
+void benchParallel(int size, int maxThreads) {
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        AIPlayer engine(Player::BLUE, 1, threads);
+        auto start = std::chrono::steady_clock::now();
+        engine.getBestMove(Board(size), BluePath::LEFT_TO_RIGHT);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << threads << " thread(s): " << static_cast<long long>(engine.getSettings().simulations / seconds)
+                  << " simulations/s" << std::endl;
+    }
+}
+
+// Search throughput on an empty board for a few batch sizes and playouts per leaf; a batch of 1 with 1 playout per
+// leaf is the unbatched loop
+void benchBatching(int size, int threads) {
+    const int configs[][2] = {{1, 1}, {8, 1}, {32, 1}, {8, 4}, {32, 4}, {32, 16}};
+    for (const auto& config : configs) {
+        AIPlayer engine(Player::BLUE, 1, threads);
+        SearchSettings settings;
+        settings.simulations = 20000;
+        settings.batch = config[0];
+        settings.leafPlayouts = config[1];
+        engine.setSettings(settings);
+        auto start = std::chrono::steady_clock::now();
+        std::pair<int, int> move = engine.getBestMove(Board(size), BluePath::LEFT_TO_RIGHT);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "batch " << config[0] << ", " << config[1] << " playout(s) per leaf: "
+                  << static_cast<long long>(settings.simulations / seconds) << " playouts/s, "
+                  << static_cast<long long>(settings.simulations / config[1] / seconds) << " descents/s, move ("
+                  << move.first << ", " << move.second << ")" << std::endl;
+    }
+}
+
+//Parameter Tuning: SPSA over the search settings by local engine-vs-engine matches
+// Every iteration shifts all tuned settings at once by +-c_k of their range, plays the + engine against the - engine
+// from a few random opening stones (each with colours swapped), and moves the settings along the measured score
+// difference. Gains follow Spall's schedule a_k = a / (k + 1 + A)^0.602, c_k = c / (k + 1)^0.101, so late
+// iterations take small, well-averaged steps. Both engines get the same playout (or time) budget, so only
+// strength per unit of search is rewarded.
+struct TunedParameter {
+    const char* name;
+    double low;
+    double high;
+};
+
+// Plays one game between two settings from a BLUE opening stone; returns the winner
+Player playTuningGame(int size, const SearchSettings& blue, const SearchSettings& red, const PatternPriors* priors,
+                      std::pair<int, int> opening, std::uint64_t seed) {
+    const BluePath bluePath = BluePath::LEFT_TO_RIGHT;
+    Board board(size);
+    AIPlayer blueEngine(Player::BLUE, seed), redEngine(Player::RED, seed + 1);
+    blueEngine.setSettings(blue);
+    redEngine.setSettings(red);
+    blueEngine.setPriors(priors);
+    redEngine.setPriors(priors);
+    board.makeMove(opening.first, opening.second, Player::BLUE);
+    Player toMove = Player::RED;
+    while (true) {
+        std::pair<int, int> move = (toMove == Player::BLUE ? blueEngine : redEngine).getBestMove(board, bluePath);
+        board.makeMove(move.first, move.second, toMove);
+        if (board.hasWinner(toMove, bluePath)) return toMove;
+        toMove = (toMove == Player::BLUE) ? Player::RED : Player::BLUE;
+    }
+}
+
+// Tunes `start` for `iterations` rounds and writes the result (also every ten rounds) to outputPath
+void runTuning(int size, int iterations, int openings, const SearchSettings& start, const PatternPriors* priors,
+               std::uint64_t seed, const std::string& outputPath) {
+    std::vector<TunedParameter> parameters = {{"exploration", 0.05, 2.5}};
+    // A widening base of 0 turns widening off and leaves alpha and beta unused, so widening is only tuned when the
+    // start has it on, and the base then stays at 1 or more
+    if (start.wideningBase > 0) {
+        parameters.push_back({"widening-base", 1, 16});
+        parameters.push_back({"widening-alpha", 0.25, 4.0});
+        parameters.push_back({"widening-beta", 0.2, 0.9});
+    }
+    if (priors != nullptr) {
+        parameters.push_back({"prior-visits", 0, 32});
+        parameters.push_back({"prior-reply", 1.0, 10.0});
+    }
+    const size_t count = parameters.size();
+    // theta holds every setting as a fraction of its range
+    std::vector<double> theta(count);
+    for (size_t i = 0; i < count; ++i) {
+        double value = start.get(parameters[i].name);
+        theta[i] = std::min(1.0, std::max(0.0, (value - parameters[i].low) / (parameters[i].high - parameters[i].low)));
+    }
+    auto settingsAt = [&](const std::vector<double>& point) {
+        SearchSettings settings = start;
+        for (size_t i = 0; i < count; ++i) {
+            double fraction = std::min(1.0, std::max(0.0, point[i]));
+            settings.set(parameters[i].name, parameters[i].low + fraction * (parameters[i].high - parameters[i].low));
+        }
+        return settings;
+    };
+
+    const double c = 0.15;
+    const double bigA = iterations / 10.0;
+    const double a = 0.05 * 2.0 * c * std::pow(1.0 + bigA, 0.602); // a full-score first round moves 5% of a range
+    Xoroshiro128Plus rng(seed);
+    double averageScore = 0.0;
+    std::cout << "Tuning " << count << " settings on " << size << "x" << size << " with " << start.simulations
+              << " playouts" << (start.moveMillis > 0 ? " or " + std::to_string(start.moveMillis) + " ms" : "")
+              << " per move, " << 2 * openings << " games per iteration" << std::endl;
+
+    for (int k = 0; k < iterations; ++k) {
+        const double ck = c / std::pow(k + 1.0, 0.101);
+        const double ak = a / std::pow(k + 1.0 + bigA, 0.602);
+        std::vector<double> delta(count), plus(count), minus(count);
+        for (size_t i = 0; i < count; ++i) {
+            delta[i] = (rng() & 1) ? 1.0 : -1.0;
+            plus[i] = theta[i] + ck * delta[i];
+            minus[i] = theta[i] - ck * delta[i];
+        }
+        const SearchSettings plusSettings = settingsAt(plus), minusSettings = settingsAt(minus);
+        int plusWins = 0;
+        for (int game = 0; game < openings; ++game) {
+            std::pair<int, int> opening(static_cast<int>(rng.bounded(size)), static_cast<int>(rng.bounded(size)));
+            std::uint64_t gameSeed = rng();
+            plusWins += playTuningGame(size, plusSettings, minusSettings, priors, opening, gameSeed) == Player::BLUE;
+            plusWins += playTuningGame(size, minusSettings, plusSettings, priors, opening, gameSeed) == Player::RED;
+        }
+        const double score = (2.0 * plusWins - 2 * openings) / (2 * openings); // +1: the + engine won every game
+        averageScore = k == 0 ? score : 0.9 * averageScore + 0.1 * score;
+        for (size_t i = 0; i < count; ++i) {
+            theta[i] = std::min(1.0, std::max(0.0, theta[i] + ak * score / (2.0 * ck) * delta[i]));
+        }
+
+        const SearchSettings current = settingsAt(theta);
+        std::cout << "iteration " << k + 1 << " score " << score << " average " << averageScore << " step " << ck;
+        for (size_t i = 0; i < count; ++i) std::cout << ' ' << parameters[i].name << '=' << current.get(parameters[i].name);
+        std::cout << std::endl;
+        if ((k + 1) % 10 == 0 || k + 1 == iterations) {
+            current.save(outputPath, "SPSA, " + std::to_string(k + 1) + " iterations on " + std::to_string(size) + "x" +
+                                         std::to_string(size) + ", seed " + std::to_string(seed));
+        }
+    }
+    std::cout << "Tuned settings written to " << outputPath << std::endl;
+}
+
+int main(int argc, char* argv[]) {
     int boardSize = 3; // Example board size
     Player userPlayer = Player::RED; // Example: User plays as RED
+    std::uint64_t seed = RandomStreams::clockSeed();
+    int threads = 1;
+    size_t nodeBudget = 0;
+    size_t memoryBudgetMB = 0;
+    int widening = 0;
+    std::string tablePath;
+    std::string priorsPath;
+    std::string configPath;
+    std::string tunePath;
+    int tuneIterations = 0;
+    int tuneOpenings = 2;
+    int playouts = 0, moveMillis = -1; // overrides of the settings, when given
+    int batch = 0, leafPlayouts = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--node-budget" && i + 1 < argc) {
+            nodeBudget = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--tree-memory-mb" && i + 1 < argc) {
+            memoryBudgetMB = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--widening" && i + 1 < argc) {
+            widening = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--table" && i + 1 < argc) {
+            tablePath = argv[++i];
+        } else if (arg == "--priors" && i + 1 < argc) {
+            priorsPath = argv[++i];
+        } else if (arg == "--config" && i + 1 < argc) {
+            configPath = argv[++i];
+        } else if (arg == "--playouts" && i + 1 < argc) {
+            playouts = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--move-ms" && i + 1 < argc) {
+            moveMillis = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--tune" && i + 2 < argc) {
+            tuneIterations = std::max(1, std::atoi(argv[++i]));
+            tunePath = argv[++i];
+        } else if (arg == "--tune-openings" && i + 1 < argc) {
+            tuneOpenings = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--size" && i + 1 < argc) {
+            boardSize = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batch = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--leaf-playouts" && i + 1 < argc) {
+            leafPlayouts = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--bench-batch" && i + 1 < argc) {
+            benchBatching(std::atoi(argv[i + 1]), threads);
+            return 0;
+        } else if (arg == "--bench-parallel" && i + 1 < argc) {
+            benchParallel(std::atoi(argv[i + 1]), std::max(16, threads));
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
 
-    AIGame game(boardSize, userPlayer);
+    SearchSettings settings;
+    if (!configPath.empty() && !settings.load(configPath)) {
+        std::cerr << "Cannot read settings " << configPath << std::endl;
+        return 1;
+    }
+    if (playouts > 0) settings.simulations = playouts;
+    if (moveMillis >= 0) settings.moveMillis = moveMillis;
+    if (widening > 0) settings.wideningBase = widening;
+    if (batch > 0) settings.batch = batch;
+    if (leafPlayouts > 0) settings.leafPlayouts = leafPlayouts;
+    PatternPriors* priors = nullptr;
+    if (!priorsPath.empty()) {
+        priors = new PatternPriors(priorsPath);
+        if (!priors->isOpen()) {
+            std::cerr << "Cannot read prior table " << priorsPath << std::endl;
+            delete priors;
+            return 1;
+        }
+    }
+    if (tuneIterations > 0) {
+        runTuning(boardSize, tuneIterations, tuneOpenings, settings, priors, seed, tunePath);
+        delete priors;
+        return 0;
+    }
+
+    AIGame game(boardSize, userPlayer, seed);
+    game.setThreads(threads);
+    game.setSettings(settings);
+    game.setPriors(priors);
+    if (memoryBudgetMB > 0) {
+        game.setMemoryBudget(memoryBudgetMB << 20);
+    } else {
+        game.setNodeBudget(nodeBudget);
+    }
+    PerfectPlayTable* table = nullptr;
+    if (!tablePath.empty()) {
+        table = new PerfectPlayTable(tablePath);
+        if (!table->isOpen()) {
+            std::cerr << "Cannot read perfect-play table " << tablePath << std::endl;
+            delete table;
+            delete priors;
+            return 1;
+        }
+        game.setTable(table);
+    }
     game.play();
 
+    delete table;
+    delete priors;
     return 0;
 }
@@ -7,16 +7,58 @@
 #include <random>
 #include <ctime>
 #include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <deque>
+#include <queue>
+#include <cstdio>
+#include <atomic>
+#include <memory>
+#include <array>
+#include <bitset>
+#include <cerrno>
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 enum class Player : short { BLUE, RED, BLANK };
 enum class BluePath : short { LEFT_TO_RIGHT, TOP_TO_BOTTOM };
 
+// Offsets (dx, dy) of the six neighbours of a hex cell
+static const int hexDirections[6][2] = {{-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}};
+
 class Board {
 private:
     int size; // Size of the board (size x size)
     std::vector<std::vector<Player>> grid; // 2D vector to represent the board grid with outer vector represents the rows and the inner vector represents the columns. 
     std::unordered_set<int> blueCoords; // store coordinates of blue player's moves with formula index = x*size+y
     std::unordered_set<int> redCoords; //store coordinates of red player's moves with formula index = x*size+y 
+    // Cells placed with placeStone, newest last, so playouts can roll back instead of copying. Journaled stones stay
+    // out of the coordinate sets, so a playout move allocates nothing.
+    std::vector<int> journal;
 
 public:
     Board(int size) : size(size), grid(size, std::vector<Player>(size, Player::BLANK)) {}
@@ -43,113 +85,484 @@ public:
         }
     }
 
+    // Playout move: no validity check, and recorded in the journal for rollback
+    void placeStone(int x, int y, Player player) {
+        grid[x][y] = player;
+        journal.push_back(x * size + y);
+    }
+
+    size_t journalMark() const {
+        return journal.size();
+    }
+
+    // Takes back every stone placed since `mark`, newest first
+    void rollback(size_t mark) {
+        while (journal.size() > mark) {
+            int cell = journal.back();
+            journal.pop_back();
+            grid[cell / size][cell % size] = Player::BLANK;
+        }
+    }
+
     Player getPlayerAt(int x, int y) const {
         return grid[x][y];
     }
+
+    // Swap rule: the opening stone at (x, y) becomes the other colour's stone at the mirrored cell (y, x). Mirroring
+    // turns one player's edges into the other's, so the second player takes over exactly the opener's position.
+    void swapStone(int x, int y) {
+        Player stone = grid[x][y];
+        Player other = stone == Player::BLUE ? Player::RED : Player::BLUE;
+        (stone == Player::BLUE ? blueCoords : redCoords).erase(x * size + y);
+        grid[x][y] = Player::BLANK;
+        grid[y][x] = other;
+        (other == Player::BLUE ? blueCoords : redCoords).emplace(y * size + x);
+    }
+
+    int stonesPlaced() const {
+        return static_cast<int>(blueCoords.size() + redCoords.size() + journal.size());
+    }
     //Displaying Staggered Effect Visual 
     void display() const {
-        std::cout << "  ";
+        std::string frame;
+        appendFrame(frame);
+        std::cout.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+        std::cout.flush();
+    }
+
+    // The staggered board as text, appended to `out` so callers can reuse one buffer
+    void appendFrame(std::string& out) const {
+        out += "  ";
         for (int col = 0; col < size; ++col) {
-            std::cout << "  " << col << " ";
+            out += "  " + std::to_string(col) + " ";
         }
-        std::cout << std::endl;
+        out += '\n';
 
         for (int row = 0; row < size; ++row) {
-            std::cout << std::string(row * 2, ' ');
-            std::cout << row << " ";
+            out.append(row * 2, ' ');
+            out += std::to_string(row) + " ";
             for (int col = 0; col < size; ++col) {
-                char ch;
-                switch (grid[row][col]) {
-                    case Player::BLUE: ch = 'B'; break;
-                    case Player::RED: ch = 'R'; break;
-                    default: ch = '.'; break;
-                }
-                std::cout << ch;
+                out += symbol(grid[row][col]);
                 if (col < size - 1) {
-                    std::cout << " - ";
+                    out += " - ";
                 }
             }
-            std::cout << std::endl;
+            out += '\n';
 
             if (row < size - 1) {
-                std::cout << std::string(row * 2 + 1, ' ') << " \\ /";
-                for (int k = 1; k < size; ++k) {
-                    std::cout << " \\ /";
+                out.append(row * 2 + 1, ' ');
+                for (int k = 0; k < size; ++k) {
+                    out += " \\ /";
                 }
-                std::cout << std::endl;
+                out += '\n';
             }
         }
     }
+
+    // Line and column (both from 0) where appendFrame draws cell (row, col)
+    std::pair<int, int> cellPosition(int row, int col) const {
+        return {1 + 2 * row, 2 * row + static_cast<int>(std::to_string(row).size()) + 1 + 4 * col};
+    }
+
+    static char symbol(Player player) {
+        switch (player) {
+            case Player::BLUE: return 'B';
+            case Player::RED: return 'R';
+            default: return '.';
+        }
+    }
   //Heart of Code for Checking Winner for Blue and Red Simultaneoously
+    // Flood fill from the player's first edge. BLUE joins the edges named by bluePath and RED the other pair. The visit
+    // stamps and the stack are per thread and keep their capacity, so a check allocates nothing once warmed up.
     bool hasWinner(Player player, BluePath bluePath) const {
-        std::vector<std::vector<bool>> visited(size, std::vector<bool>(size, false));
-        if (player == Player::BLUE) {
-            if (bluePath == BluePath::LEFT_TO_RIGHT) {
-                for (int i = 0; i < size; ++i) {
-                    visited = std::vector<std::vector<bool>>(size, std::vector<bool>(size, false));
-                    if (grid[i][0] == Player::BLUE && !visited[i][0]) {
-                        if (dfs(i, 0, Player::BLUE, visited, bluePath)) return true;
-                    }
-                }
-            } else if (bluePath == BluePath::TOP_TO_BOTTOM) {
-                for (int j = 0; j < size; ++j) {
-                    visited = std::vector<std::vector<bool>>(size, std::vector<bool>(size, false));
-                    if (grid[0][j] == Player::BLUE && !visited[0][j]) {
-                        if (dfs(0, j, Player::BLUE, visited, bluePath)) return true;
-                    }
+        thread_local std::vector<unsigned> visited; // cell -> stamp of the last check that reached it
+        thread_local std::vector<int> stack;
+        thread_local unsigned stamp = 0;
+        const int cells = size * size;
+        if (static_cast<int>(visited.size()) < cells) visited.assign(cells, 0);
+        if (++stamp == 0) {
+            std::fill(visited.begin(), visited.end(), 0);
+            stamp = 1;
+        }
+        const bool acrossColumns = (player == Player::BLUE) == (bluePath == BluePath::LEFT_TO_RIGHT);
+        stack.clear();
+        for (int k = 0; k < size; ++k) {
+            const int x = acrossColumns ? k : 0, y = acrossColumns ? 0 : k;
+            if (grid[x][y] == player) {
+                visited[x * size + y] = stamp;
+                stack.push_back(x * size + y);
+            }
+        }
+        while (!stack.empty()) {
+            const int x = stack.back() / size, y = stack.back() % size;
+            stack.pop_back();
+            if ((acrossColumns ? y : x) == size - 1) return true;
+            for (const auto& direction : hexDirections) {
+                const int nx = x + direction[0], ny = y + direction[1];
+                if (nx >= 0 && nx < size && ny >= 0 && ny < size && grid[nx][ny] == player &&
+                    visited[nx * size + ny] != stamp) {
+                    visited[nx * size + ny] = stamp;
+                    stack.push_back(nx * size + ny);
                 }
             }
         }
+        return false;
+    }
+};
 
-        if (player == Player::RED) {
-            if (bluePath == BluePath::LEFT_TO_RIGHT) {
-                for (int j = 0; j < size; ++j) {
-                    visited = std::vector<std::vector<bool>>(size, std::vector<bool>(size, false));
-                    if (grid[0][j] == Player::RED && !visited[0][j]) {
-                        if (dfs(0, j, Player::RED, visited, bluePath)) return true;
-                    }
-                }
-            } else if (bluePath == BluePath::TOP_TO_BOTTOM) {
-                for (int i = 0; i < size; ++i) {
-                    visited = std::vector<std::vector<bool>>(size, std::vector<bool>(size, false));
-                    if (grid[i][0] == Player::RED && !visited[i][0]) {
-                        if (dfs(i, 0, Player::RED, visited, bluePath)) return true;
-                    }
-                }
+//Rendering: each frame is built in one reused buffer and written at once
+// FULL redraws the whole board. DIFF clears the screen once, then only repaints the cells that changed, using ANSI
+// cursor moves, and keeps the messages below the board. QUIET draws nothing, for batch and engine-vs-engine play.
+class BoardRenderer {
+public:
+    enum class Mode { FULL, DIFF, QUIET };
+
+private:
+    Mode mode;
+    std::string buffer;       // keeps its capacity between frames
+    std::vector<Player> shown; // what DIFF mode has on screen, empty before its first frame
+
+public:
+    explicit BoardRenderer(Mode mode = Mode::FULL) : mode(mode) {}
+
+    void setMode(Mode renderMode) {
+        mode = renderMode;
+        shown.clear();
+    }
+
+    void draw(const Board& board) {
+        if (mode == Mode::QUIET) return;
+        const int size = board.getSize();
+        buffer.clear();
+        if (mode == Mode::FULL || shown.size() != static_cast<size_t>(size * size)) {
+            if (mode == Mode::DIFF) buffer += "\x1b[2J\x1b[H"; // clear the screen, board at the top
+            board.appendFrame(buffer);
+            if (mode == Mode::DIFF) {
+                shown.resize(size * size);
+                for (int cell = 0; cell < size * size; ++cell) shown[cell] = board.getPlayerAt(cell / size, cell % size);
+            }
+        } else {
+            for (int cell = 0; cell < size * size; ++cell) {
+                Player stone = board.getPlayerAt(cell / size, cell % size);
+                if (stone == shown[cell]) continue;
+                std::pair<int, int> position = board.cellPosition(cell / size, cell % size);
+                buffer += "\x1b[" + std::to_string(position.first + 1) + ";" + std::to_string(position.second + 1) + "H";
+                buffer += Board::symbol(stone);
+                shown[cell] = stone;
             }
+            // Park the cursor under the board and clear the previous turn's messages
+            buffer += "\x1b[" + std::to_string(2 * size + 1) + ";1H\x1b[J";
         }
+        std::cout.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        std::cout.flush();
+    }
+};
 
-        return false;
+//Game Records: compact binary archive of finished games
+//Each game is one frame: a 32-byte header, packed moves (padded to 8 bytes), then optional per-move search stats
+struct GameRecordHeader {
+    char magic[4];              // "HEXG"
+    std::uint8_t version;       // format version, currently 1
+    std::uint8_t boardSize;
+    std::uint8_t bluePath;      // BluePath as stored in the game
+    std::uint8_t flags;         // RECORD_HAS_STATS | RECORD_WIDE_MOVES
+    std::uint8_t winner;        // 0 = BLUE, 1 = RED, 2 = no winner (draw or abandoned)
+    std::uint8_t aiMask;        // bit 0: BLUE is an engine, bit 1: RED is an engine
+    std::uint16_t moveCount;
+    std::uint32_t simulations;  // engine config: trials per candidate move
+    std::uint32_t reserved;
+    std::uint64_t seed;         // engine seed, replays the game together with the config
+};
+static_assert(sizeof(GameRecordHeader) == 32, "GameRecordHeader must stay 32 bytes");
+
+// Per-move engine statistics (all zero for human moves)
+struct MoveStats {
+    std::uint32_t playouts;     // trials spent on the decision
+    std::uint16_t winRate;      // win rate of the chosen move scaled to 0..65535
+    std::uint16_t candidates;   // number of candidate moves evaluated
+};
+static_assert(sizeof(MoveStats) == 8, "MoveStats must stay 8 bytes");
+
+const std::uint8_t RECORD_HAS_STATS = 1;   // stats block follows the moves
+const std::uint8_t RECORD_WIDE_MOVES = 2;  // moves stored as 16-bit x*size+y (boards larger than 16x16)
+const std::uint8_t RECORD_SWAPPED = 4;     // RED swapped: move 0 stands as a RED stone at (y, x) and BLUE moves next
+
+inline std::size_t recordMovesBytes(const GameRecordHeader& header) {
+    std::size_t raw = static_cast<std::size_t>(header.moveCount) * ((header.flags & RECORD_WIDE_MOVES) ? 2 : 1);
+    return (raw + 7) & ~static_cast<std::size_t>(7);
+}
+
+inline std::size_t recordFrameBytes(const GameRecordHeader& header) {
+    return sizeof(GameRecordHeader) + recordMovesBytes(header) +
+           ((header.flags & RECORD_HAS_STATS) ? header.moveCount * sizeof(MoveStats) : 0);
+}
+
+// Append-only writer: moves are buffered for the current game and the whole frame goes out in one write
+class GameRecordWriter {
+private:
+    std::ofstream out;
+    GameRecordHeader header;
+    std::vector<std::pair<int, int>> moves;
+    std::vector<MoveStats> stats;
+    bool hasStats;
+    bool inGame;
+
+public:
+    explicit GameRecordWriter(const std::string& path)
+        : out(path, std::ios::binary | std::ios::app), header(), hasStats(false), inGame(false) {}
+
+    bool isOpen() const {
+        return out.is_open();
+    }
+
+    void beginGame(int size, BluePath bluePath, std::uint8_t aiMask, std::uint32_t simulations, std::uint64_t seed) {
+        header = GameRecordHeader();
+        std::memcpy(header.magic, "HEXG", 4);
+        header.version = 1;
+        header.boardSize = static_cast<std::uint8_t>(size);
+        header.bluePath = static_cast<std::uint8_t>(bluePath);
+        header.flags = size > 16 ? RECORD_WIDE_MOVES : 0;
+        header.winner = 2;
+        header.aiMask = aiMask;
+        header.simulations = simulations;
+        header.seed = seed;
+        moves.clear();
+        stats.clear();
+        hasStats = false;
+        inGame = true;
+    }
+
+    // Marks the opening as swapped (see RECORD_SWAPPED); the swap itself takes no move slot
+    void markSwap() {
+        if (inGame) header.flags |= RECORD_SWAPPED;
+    }
+
+    void addMove(int x, int y, const MoveStats* moveStats = nullptr) {
+        if (!inGame || moves.size() == 0xFFFF) return;
+        moves.emplace_back(x, y);
+        stats.push_back(moveStats ? *moveStats : MoveStats());
+        hasStats = hasStats || moveStats != nullptr;
     }
 
+    // Writes the frame; winner is Player::BLANK for a draw or an abandoned game
+    void endGame(Player winner) {
+        if (!inGame) return;
+        inGame = false;
+        header.winner = winner == Player::BLUE ? 0 : winner == Player::RED ? 1 : 2;
+        header.moveCount = static_cast<std::uint16_t>(moves.size());
+        if (hasStats) header.flags |= RECORD_HAS_STATS;
+
+        std::string frame(recordFrameBytes(header), '\0');
+        std::memcpy(&frame[0], &header, sizeof(header));
+        char* cursor = &frame[sizeof(header)];
+        int size = header.boardSize;
+        for (std::size_t i = 0; i < moves.size(); ++i) {
+            if (header.flags & RECORD_WIDE_MOVES) {
+                std::uint16_t packed = static_cast<std::uint16_t>(moves[i].first * size + moves[i].second);
+                std::memcpy(cursor + 2 * i, &packed, 2);
+            } else {
+                cursor[i] = static_cast<char>((moves[i].first << 4) | moves[i].second);
+            }
+        }
+        if (hasStats) {
+            std::memcpy(&frame[sizeof(header) + recordMovesBytes(header)], stats.data(), stats.size() * sizeof(MoveStats));
+        }
+        out.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+        out.flush();
+    }
+};
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+private:
+    const unsigned char* base;
+    std::size_t length;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+
+public:
+    explicit MappedFile(const std::string& path) : base(nullptr), length(0) {
+#ifdef _WIN32
+        mapping = nullptr;
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) return;
+        length = static_cast<std::size_t>(fileSize.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) return;
+        base = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) return;
+        length = static_cast<std::size_t>(st.st_size);
+        void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED) return;
+        madvise(view, length, MADV_SEQUENTIAL);
+        base = static_cast<const unsigned char*>(view);
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (base) UnmapViewOfFile(base);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+        if (base) munmap(const_cast<unsigned char*>(base), length);
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const {
+        return base;
+    }
+
+    std::size_t size() const {
+        return base ? length : 0;
+    }
+};
+
+// A game inside a mapped archive; pointers refer straight into the mapping
+struct GameView {
+    const GameRecordHeader* header;
+    const unsigned char* moves;
+    const MoveStats* stats; // nullptr when the game was recorded without stats
+
+    std::pair<int, int> move(int index) const {
+        if (header->flags & RECORD_WIDE_MOVES) {
+            std::uint16_t packed;
+            std::memcpy(&packed, moves + 2 * index, 2);
+            return {packed / header->boardSize, packed % header->boardSize};
+        }
+        return {moves[index] >> 4, moves[index] & 0x0F};
+    }
+
+    // Where move `index` leaves its stone and in which colour; after a swap the opening stands mirrored as RED's and
+    // the colours of the later moves start again from BLUE. The side choosing move 0 is always BLUE.
+    std::pair<int, int> stone(int index) const {
+        std::pair<int, int> cell = move(index);
+        return index == 0 && (header->flags & RECORD_SWAPPED) ? std::make_pair(cell.second, cell.first) : cell;
+    }
+
+    Player colour(int index) const {
+        const bool swapped = (header->flags & RECORD_SWAPPED) != 0;
+        return (index % 2 == 0) != swapped ? Player::BLUE : Player::RED;
+    }
+};
+
+// Zero-copy sequential reader over a record archive
+class GameRecordReader {
+private:
+    MappedFile file;
+    std::size_t offset;
+
+public:
+    explicit GameRecordReader(const std::string& path) : file(path), offset(0) {}
+
+    bool isOpen() const {
+        return file.data() != nullptr;
+    }
+
+    // Advances to the next game; returns false at the end of the archive or on a damaged frame
+    bool next(GameView& view) {
+        if (offset + sizeof(GameRecordHeader) > file.size()) return false;
+        const GameRecordHeader* header = reinterpret_cast<const GameRecordHeader*>(file.data() + offset);
+        if (std::memcmp(header->magic, "HEXG", 4) != 0 || header->version != 1) return false;
+        std::size_t frame = recordFrameBytes(*header);
+        if (offset + frame > file.size()) return false;
+
+        view.header = header;
+        view.moves = file.data() + offset + sizeof(GameRecordHeader);
+        view.stats = (header->flags & RECORD_HAS_STATS)
+                         ? reinterpret_cast<const MoveStats*>(view.moves + recordMovesBytes(*header))
+                         : nullptr;
+        offset += frame;
+        return true;
+    }
+};
+
+//Swap Rule: per-size tables of opening values, built offline and mapped at startup
+// A table holds, for every first stone, the chance that BLUE (the opener) wins, in the frame where BLUE joins the left
+// and right edges. Swapping is worth it above one half; openings close to one half are swap-safe.
+struct FirstMoveTableHeader {
+    char magic[4];       // "HEXO"
+    std::uint8_t version;
+    std::uint8_t boardSize;
+    std::uint8_t exact;  // 1: values are solved wins and losses, 0: search estimates
+    std::uint8_t reserved;
+    std::uint32_t trials; // trials per reply of the search that estimated the values
+    std::uint32_t reservedWord;
+    std::uint64_t seed;
+    std::uint64_t reservedLong;
+};
+static_assert(sizeof(FirstMoveTableHeader) == 32, "FirstMoveTableHeader must stay 32 bytes");
+
+class FirstMoveTable {
 private:
-    // Using Depth-first search algorithm to check for a path from (x, y) to an edge of the board
-    bool dfs(int x, int y, Player player, std::vector<std::vector<bool>>& visited, BluePath bluePath) const {
-        visited[x][y] = true;
-        //Relative Neighbour Position
-        std::vector<std::pair<int, int>> directions = {
-            {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}
-        };
-        
-        // Check if the current position is at the final position according to the blue path
+    MappedFile file;
+    const FirstMoveTableHeader* header;
+    const float* values;
+
+public:
+    explicit FirstMoveTable(const std::string& path) : file(path), header(nullptr), values(nullptr) {
+        if (file.size() < sizeof(FirstMoveTableHeader)) return;
+        const FirstMoveTableHeader* candidate = reinterpret_cast<const FirstMoveTableHeader*>(file.data());
+        if (std::memcmp(candidate->magic, "HEXO", 4) != 0 || candidate->version != 1 ||
+            file.size() < sizeof(FirstMoveTableHeader) + candidate->boardSize * candidate->boardSize * sizeof(float)) {
+            return;
+        }
+        header = candidate;
+        values = reinterpret_cast<const float*>(file.data() + sizeof(FirstMoveTableHeader));
+    }
+
+    bool isOpen() const {
+        return header != nullptr;
+    }
 
-        if (player == Player::BLUE) {
-            if (bluePath == BluePath::LEFT_TO_RIGHT && y == size - 1) return true;
-            if (bluePath == BluePath::TOP_TO_BOTTOM && x == size - 1) return true;
-        } else if (player == Player::RED) {
-            if (bluePath == BluePath::LEFT_TO_RIGHT && x == size - 1) return true;
-            if (bluePath == BluePath::TOP_TO_BOTTOM && y == size - 1) return true;
+    int boardSize() const {
+        return header ? header->boardSize : 0;
+    }
+
+    // BLUE's winning chance after opening at (x, y)
+    double value(int x, int y, BluePath bluePath) const {
+        const int size = header->boardSize;
+        return bluePath == BluePath::LEFT_TO_RIGHT ? values[x * size + y] : values[y * size + x];
+    }
+
+    // The opening with the best value for BLUE, for games without the swap rule
+    std::pair<int, int> strongestOpening(BluePath bluePath) const {
+        const int size = header->boardSize;
+        std::pair<int, int> best(0, 0);
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                if (value(x, y, bluePath) > value(best.first, best.second, bluePath)) best = {x, y};
+            }
         }
-        // Explore neighbors recursively
-        for (const auto& direction : directions) {
-            int nx = x + direction.first;
-            int ny = y + direction.second;
-            if (nx >= 0 && nx < size && ny >= 0 && ny < size &&
-                !visited[nx][ny] && grid[nx][ny] == player) {
-                if (dfs(nx, ny, player, visited, bluePath)) return true;
+        return best;
+    }
+
+    // The opening whose value is closest to one half, so neither answer to the swap question gains much
+    std::pair<int, int> swapSafeOpening(BluePath bluePath) const {
+        const int size = header->boardSize;
+        std::pair<int, int> best(0, 0);
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                if (std::fabs(value(x, y, bluePath) - 0.5) < std::fabs(value(best.first, best.second, bluePath) - 0.5)) {
+                    best = {x, y};
+                }
             }
         }
-        return false;
+        return best;
     }
 };
 
@@ -158,13 +571,66 @@ protected:
     Board board;
     Player currentPlayer;
     BluePath bluePath;
+    GameRecordWriter* recorder; // optional archive, not owned
+    BoardRenderer renderer;
+    bool swapRule;                  // RED may take over BLUE's opening stone instead of replying
+    const FirstMoveTable* openings; // optional opening values, not owned
 
 public:
-    Game(int size) : board(size), currentPlayer(Player::BLUE), bluePath(BluePath::LEFT_TO_RIGHT) {}
+    Game(int size) : board(size), currentPlayer(Player::BLUE), bluePath(BluePath::LEFT_TO_RIGHT), recorder(nullptr),
+                     swapRule(false), openings(nullptr) {}
 
     virtual void play() = 0;//Function for Calling Method Of Play
 
+    void setRecorder(GameRecordWriter* writer) {
+        recorder = writer;
+    }
+
+    void setSwapRule(bool enabled) {
+        swapRule = enabled;
+    }
+
+    void setFirstMoveTable(const FirstMoveTable* table) {
+        openings = table;
+    }
+
+    void setRenderMode(BoardRenderer::Mode mode) {
+        renderer.setMode(mode);
+    }
+
 protected:
+    void startRecord(std::uint8_t aiMask, std::uint32_t simulations, std::uint64_t seed) {
+        if (recorder) recorder->beginGame(board.getSize(), bluePath, aiMask, simulations, seed);
+    }
+
+    void recordMove(int x, int y, const MoveStats* stats = nullptr) {
+        if (recorder) recorder->addMove(x, y, stats);
+    }
+
+    void finishRecord(Player winner) {
+        if (recorder) recorder->endGame(winner);
+    }
+
+    // The opening table when there is one for this board size
+    const FirstMoveTable* openingTable() const {
+        return openings != nullptr && openings->boardSize() == board.getSize() ? openings : nullptr;
+    }
+
+    bool askSwap() {
+        char answer;
+        std::cout << "Player RED, swap the opening stone? (y/n): ";
+        std::cin >> answer;
+        return answer == 'y' || answer == 'Y';
+    }
+
+    // RED takes over the opening at (x, y) as its own move; BLUE is to move again
+    void swapOpening(int x, int y) {
+        board.swapStone(x, y);
+        if (recorder) recorder->markSwap();
+        currentPlayer = Player::BLUE;
+        std::cout << "RED swaps: the opening stone is now RED's at (" << y << ", " << x << ")" << std::endl;
+    }
+
     void askBluePath() {
         int choice;
         std::cout << "Player BLUE, choose your path:\n";
@@ -195,9 +661,10 @@ public:
     void play() override {
         askBluePath();
         int moveCount = 0;
+        startRecord(0, 0, 0);
 
         while (true) {
-            board.display();
+            renderer.draw(board);
             int x, y;
             bool validMove = false;
 
@@ -215,17 +682,22 @@ public:
 
                 if (board.isValidMove(x, y)) {
                     board.makeMove(x, y, currentPlayer);
+                    recordMove(x, y);
                     validMove = true;
                     moveCount++;
 
                     if (board.hasWinner(currentPlayer, bluePath)) {
-                        board.display();
+                        finishRecord(currentPlayer);
+                        renderer.draw(board);
                         std::cout << "Player " << (currentPlayer == Player::BLUE ? "BLUE" : "RED")
                                   << " wins!" << std::endl;
                         return;
                     }
 
                     currentPlayer = (currentPlayer == Player::BLUE) ? Player::RED : Player::BLUE;
+                    if (swapRule && moveCount == 1 && askSwap()) {
+                        swapOpening(x, y);
+                    }
                 } else {
                     std::cerr << "Invalid move. The coordinate is preoccupied or out of bounds. Try again."
                               << std::endl;
@@ -233,6 +705,7 @@ public:
             }
 
             if (checkDraw(moveCount)) {
+                finishRecord(Player::BLANK);
                 std::cout << "Game over! It's a draw!" << std::endl;
                 break;
             }
@@ -240,184 +713,4704 @@ public:
     }
 };
 
-class AIPlayer {
+//Random Number Layer: small-state playout generator plus counter-based streams
+//splitmix64 finaliser, used to expand a 64-bit seed into generator state
+inline std::uint64_t splitMix64(std::uint64_t& state) {
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// xoroshiro128+ : 16 bytes of state, a few cycles per draw (mt19937 carries 2.5 KB)
+class Xoroshiro128Plus {
 private:
-    Player player;
-    Player opponent;
-    std::mt19937 rng;
+    std::uint64_t s0, s1;
+
+    static std::uint64_t rotl(std::uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
 
 public:
-    AIPlayer(Player player) : player(player), opponent(player == Player::BLUE ? Player::RED : Player::BLUE) {
-        rng.seed(std::chrono::system_clock::now().time_since_epoch().count());
+    using result_type = std::uint64_t;
+
+    explicit Xoroshiro128Plus(std::uint64_t seed = 0) {
+        this->seed(seed);
     }
 
-    Player getPlayer() const {
-        return player;
+    Xoroshiro128Plus(std::uint64_t a, std::uint64_t b) : s0(a), s1(b) {
+        if (s0 == 0 && s1 == 0) s1 = 1; // the all-zero state is a fixed point
     }
 
-    std::pair<int, int> getBestMove(Board board, BluePath bluePath) {
-        int size = board.getSize();
-        std::vector<std::pair<int, int>> validMoves;
+    void seed(std::uint64_t seed) {
+        s0 = splitMix64(seed);
+        s1 = splitMix64(seed);
+    }
 
-        for (int i = 0; i < size; ++i) {
-            for (int j = 0; j < size; ++j) {
-                if (board.isValidMove(i, j)) {
-                    validMoves.emplace_back(i, j);
-                }
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type(0); }
+
+    result_type operator()() {
+        const std::uint64_t a = s0;
+        std::uint64_t b = s1;
+        const std::uint64_t result = a + b;
+        b ^= a;
+        s0 = rotl(a, 24) ^ b ^ (b << 16);
+        s1 = rotl(b, 37);
+        return result;
+    }
+
+    // Unbiased value in [0, bound) using Lemire's multiply-shift rejection
+    std::uint32_t bounded(std::uint32_t bound) {
+        std::uint64_t m = static_cast<std::uint64_t>(static_cast<std::uint32_t>((*this)() >> 32)) * bound;
+        std::uint32_t low = static_cast<std::uint32_t>(m);
+        if (low < bound) {
+            const std::uint32_t threshold = static_cast<std::uint32_t>(-bound) % bound;
+            while (low < threshold) {
+                m = static_cast<std::uint64_t>(static_cast<std::uint32_t>((*this)() >> 32)) * bound;
+                low = static_cast<std::uint32_t>(m);
             }
         }
+        return static_cast<std::uint32_t>(m >> 32);
+    }
+};
 
-        int bestMoveIndex = 0;
-        double bestWinRate = -1.0;
-        const int simulations = 1000;//Number of Simulation For Slow Performance Change it to 100
+// Philox4x32-10 counter-based generator: output block = f(key, counter), no hidden state,
+// so any stream position can be reached directly regardless of which thread asks for it
+class Philox4x32 {
+public:
+    struct Block {
+        std::uint32_t v[4];
+    };
 
-        for (size_t i = 0; i < validMoves.size(); ++i) {
-            int wins = 0;
-            for (int sim = 0; sim < simulations; ++sim) {
-                Board simBoard = board;
-                simBoard.makeMove(validMoves[i].first, validMoves[i].second, player);
-                if (simulateRandomGame(simBoard, bluePath)) {
-                    wins++;
-                }
-            }
-            double winRate = static_cast<double>(wins) / simulations;
-            if (winRate > bestWinRate) {
-                bestWinRate = winRate;
-                bestMoveIndex = i;
-            }
+    static Block generate(std::uint64_t key, Block counter) {
+        std::uint32_t k0 = static_cast<std::uint32_t>(key);
+        std::uint32_t k1 = static_cast<std::uint32_t>(key >> 32);
+        for (int round = 0; round < 10; ++round) {
+            const std::uint64_t p0 = static_cast<std::uint64_t>(0xD2511F53u) * counter.v[0];
+            const std::uint64_t p1 = static_cast<std::uint64_t>(0xCD9E8D57u) * counter.v[2];
+            counter = Block{{static_cast<std::uint32_t>(p1 >> 32) ^ counter.v[1] ^ k0,
+                             static_cast<std::uint32_t>(p1),
+                             static_cast<std::uint32_t>(p0 >> 32) ^ counter.v[3] ^ k1,
+                             static_cast<std::uint32_t>(p0)}};
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
         }
+        return counter;
+    }
+};
+
+// Reproducible random streams keyed by (seed, move, trial): the same key always yields the same
+// playout generator, no matter how many threads run the trials or in which order
+class RandomStreams {
+private:
+    std::uint64_t seed;
+
+public:
+    explicit RandomStreams(std::uint64_t seed) : seed(seed) {}
+
+    std::uint64_t getSeed() const {
+        return seed;
+    }
+
+    // ply = stones on the board, candidate = index of the evaluated move, trial = playout number
+    Xoroshiro128Plus stream(std::uint32_t ply, std::uint32_t candidate, std::uint32_t trial) const {
+        Philox4x32::Block block = Philox4x32::generate(seed, Philox4x32::Block{{trial, candidate, ply, 0}});
+        return Xoroshiro128Plus((static_cast<std::uint64_t>(block.v[0]) << 32) | block.v[1],
+                                (static_cast<std::uint64_t>(block.v[2]) << 32) | block.v[3]);
+    }
+
+    static std::uint64_t clockSeed() {
+        return static_cast<std::uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+    }
+};
 
-        return validMoves[bestMoveIndex];
+// Fisher-Yates shuffle with our own bounded draws so a seed replays identically on every standard library
+template <typename T>
+void shuffleWith(std::vector<T>& items, Xoroshiro128Plus& rng) {
+    for (std::size_t i = items.size(); i > 1; --i) {
+        std::size_t j = rng.bounded(static_cast<std::uint32_t>(i));
+        std::swap(items[i - 1], items[j]);
     }
+}
 
+//Perfect Play: exhaustive solver and memory-mapped win/loss tables for boards up to 6x6
+// Small positions are 64-bit bitboards (bit x*size+y) in a canonical orientation where BLUE joins the left and right
+// edges and RED the top and bottom; a TOP_TO_BOTTOM game is transposed into it, which keeps hex adjacency intact.
+class SmallBoardSolver {
 private:
-    bool simulateRandomGame(Board board, BluePath bluePath) {
-        std::vector<std::pair<int, int>> moves;
-        int size = board.getSize();
+    struct Entry {
+        std::uint64_t blue, red;
+        std::int8_t best;  // winning move, or -1 when empty
+        std::uint8_t wins; // side to move wins
+        bool used;
+    };
 
-        for (int i = 0; i < size; ++i) {
-            for (int j = 0; j < size; ++j) {
-                if (board.isValidMove(i, j)) {
-                    moves.emplace_back(i, j);
-                }
+    int size;
+    std::uint64_t full, firstCol, lastCol, firstRow, lastRow;
+    std::vector<int> order; // cells, most central first
+    std::vector<Entry> cache;
+    int killers[64]; // last winning move found at each stone count
+
+public:
+    static const int maxSize = 6;
+
+    explicit SmallBoardSolver(int size, int cacheBits = 22) : size(size), full(0), firstCol(0), lastCol(0), firstRow(0),
+                                                              lastRow(0), cache(std::size_t(1) << cacheBits) {
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                std::uint64_t bit = cellBit(x * size + y);
+                full |= bit;
+                if (y == 0) firstCol |= bit;
+                if (y == size - 1) lastCol |= bit;
+                if (x == 0) firstRow |= bit;
+                if (x == size - 1) lastRow |= bit;
+                order.push_back(x * size + y);
             }
         }
+        const double centre = (size - 1) / 2.0;
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            double da = std::fabs(a / size - centre) + std::fabs(a % size - centre);
+            double db = std::fabs(b / size - centre) + std::fabs(b % size - centre);
+            return da < db;
+        });
+        for (Entry& entry : cache) entry.used = false;
+        std::fill(killers, killers + 64, -1);
+    }
 
-        Player currentSimPlayer = opponent;
-        std::shuffle(moves.begin(), moves.end(), rng);
+    int getSize() const {
+        return size;
+    }
 
-        for (const auto& move : moves) {
-            board.makeMove(move.first, move.second, currentSimPlayer);
-            if (board.hasWinner(currentSimPlayer, bluePath)) {
-                return currentSimPlayer == player;
+    static std::uint64_t cellBit(int cell) {
+        return std::uint64_t(1) << cell;
+    }
+
+    static int popcount(std::uint64_t bits) {
+        int count = 0;
+        for (; bits; bits &= bits - 1) ++count;
+        return count;
+    }
+
+    // The six hex neighbours of every cell in the set
+    std::uint64_t neighbours(std::uint64_t bits) const {
+        std::uint64_t notFirst = bits & ~firstCol;
+        std::uint64_t notLast = bits & ~lastCol;
+        return ((bits >> size) | (notLast >> (size - 1)) | (notFirst >> 1) | (notLast << 1) |
+                (notFirst << (size - 1)) | (bits << size)) & full;
+    }
+
+    // Flood fill from the starting edge through the given stones
+    bool connects(std::uint64_t stones, bool blue) const {
+        std::uint64_t reach = stones & (blue ? firstCol : firstRow);
+        while (true) {
+            std::uint64_t next = reach | (neighbours(reach) & stones);
+            if (next == reach) break;
+            reach = next;
+        }
+        return (reach & (blue ? lastCol : lastRow)) != 0;
+    }
+
+    // Side to move from the stone counts, as in a game without a swap; PerfectPlayTable mirrors swapped positions
+    // into this form before it asks
+    static bool blueToMove(std::uint64_t blue, std::uint64_t red) {
+        return popcount(blue) == popcount(red);
+    }
+
+    // Negamax over win/loss with a transposition cache; returns true if the side to move wins and sets `best` to a
+    // winning move (or the most central legal move when every move loses)
+    bool solve(std::uint64_t blue, std::uint64_t red, int& best) {
+        std::size_t slot = static_cast<std::size_t>(((blue * 0x9E3779B97F4A7C15ULL) ^ (red * 0xC2B2AE3D27D4EB4FULL)) >> 20) &
+                           (cache.size() - 1);
+        Entry& entry = cache[slot];
+        if (entry.used && entry.blue == blue && entry.red == red) {
+            best = entry.best;
+            return entry.wins != 0;
+        }
+
+        const bool blueMoves = blueToMove(blue, red);
+        const std::uint64_t own = blueMoves ? blue : red;
+        const std::uint64_t other = blueMoves ? red : blue;
+        const std::uint64_t empty = full & ~(blue | red);
+        bool wins = false;
+        best = -1;
+
+        // Immediate wins, then the opponent's immediate threats: two of them cannot both be blocked
+        std::uint64_t threats = 0;
+        for (int cell : order) {
+            if (!(empty & cellBit(cell))) continue;
+            if (best < 0) best = cell;
+            if (connects(own | cellBit(cell), blueMoves)) {
+                best = cell;
+                wins = true;
+                break;
+            }
+            if (connects(other | cellBit(cell), !blueMoves)) {
+                threats |= cellBit(cell);
+            }
+        }
+        if (!wins && popcount(threats) <= 1) {
+            // The move that last refuted a sibling position at this depth is tried first
+            const int depth = popcount(blue | red);
+            const int killer = killers[depth];
+            for (int i = -1; i < static_cast<int>(order.size()); ++i) {
+                int cell = (i < 0) ? killer : order[i];
+                if (cell < 0 || (i >= 0 && cell == killer)) continue;
+                if (!(empty & cellBit(cell))) continue;
+                if (threats && !(threats & cellBit(cell))) continue; // must block the single threat
+                int reply;
+                bool childWins = blueMoves ? solve(blue | cellBit(cell), red, reply)
+                                           : solve(blue, red | cellBit(cell), reply);
+                if (!childWins) {
+                    best = cell;
+                    wins = true;
+                    killers[depth] = cell;
+                    break;
+                }
             }
-            currentSimPlayer = (currentSimPlayer == Player::BLUE) ? Player::RED : Player::BLUE;
         }
 
-        return false;
+        entry.blue = blue;
+        entry.red = red;
+        entry.best = static_cast<std::int8_t>(best);
+        entry.wins = wins ? 1 : 0;
+        entry.used = true;
+        return wins;
     }
 };
-//AI Agent which uses MCS algorithm for Efficient Computation of Trials
-class AIGame : public Game {
+
+// Canonical key of a small position: base-3 digits (0 empty, 1 BLUE, 2 RED) over cells, minimised over the 180 degree
+// rotation. `rotated` reports whether the key came from the rotated board.
+inline std::uint64_t smallBoardKey(std::uint64_t blue, std::uint64_t red, int size, bool& rotated) {
+    std::uint64_t plain = 0, turned = 0;
+    const int cells = size * size;
+    for (int i = cells - 1; i >= 0; --i) {
+        plain = plain * 3 + ((blue >> i) & 1) + 2 * ((red >> i) & 1);
+    }
+    for (int i = 0; i < cells; ++i) {
+        turned = turned * 3 + ((blue >> i) & 1) + 2 * ((red >> i) & 1);
+    }
+    rotated = turned < plain;
+    return rotated ? turned : plain;
+}
+
+// Table file: header, open-addressed key slots (key + 1, 0 = empty), then one info byte per slot
+// (bit 7: side to move wins, bits 0-5: best move in the canonical frame)
+struct PerfectTableHeader {
+    char magic[4];       // "HEXT"
+    std::uint8_t version;
+    std::uint8_t boardSize;
+    std::uint16_t maxStones;
+    std::uint32_t reserved;
+    std::uint64_t slotCount; // power of two
+    std::uint64_t entryCount;
+};
+static_assert(sizeof(PerfectTableHeader) == 32, "PerfectTableHeader must stay 32 bytes");
+
+inline std::uint64_t perfectTableSlot(std::uint64_t key, std::uint64_t slotCount) {
+    return ((key + 1) * 0x9E3779B97F4A7C15ULL >> 17) & (slotCount - 1);
+}
+
+// Memory-mapped perfect-play table: one hash probe per lookup, shared read-only by every engine in the process
+class PerfectPlayTable {
 private:
-    AIPlayer aiPlayer;
+    MappedFile file;
+    const PerfectTableHeader* header;
+    const std::uint64_t* keys;
+    const std::uint8_t* info;
 
 public:
-    AIGame(int size, Player userPlayer) : Game(size), aiPlayer(userPlayer == Player::BLUE ? Player::RED : Player::BLUE) {
-        currentPlayer = Player::BLUE;
-        if (userPlayer == Player::RED) {
-            askBluePath();
-        } else {
-            askUserPath();
+    explicit PerfectPlayTable(const std::string& path) : file(path), header(nullptr), keys(nullptr), info(nullptr) {
+        if (file.size() < sizeof(PerfectTableHeader)) return;
+        const PerfectTableHeader* candidate = reinterpret_cast<const PerfectTableHeader*>(file.data());
+        if (std::memcmp(candidate->magic, "HEXT", 4) != 0 || candidate->version != 1 ||
+            file.size() < sizeof(PerfectTableHeader) + candidate->slotCount * 9) {
+            return;
         }
+        header = candidate;
+        keys = reinterpret_cast<const std::uint64_t*>(file.data() + sizeof(PerfectTableHeader));
+        info = file.data() + sizeof(PerfectTableHeader) + header->slotCount * sizeof(std::uint64_t);
     }
-    //Game loop
-    void play() override {
-        int moveCount = 0;
-        Player userPlayer = aiPlayer.getPlayer() == Player::BLUE ? Player::RED : Player::BLUE;
 
-        while (true) {
-            board.display();
-            if (currentPlayer == userPlayer) {
-                int x, y;
-                bool validMove = false;
+    bool isOpen() const {
+        return header != nullptr;
+    }
 
-                while (!validMove) {
-                    std::cout << "Player " << (currentPlayer == Player::BLUE ? "BLUE" : "RED")
-                              << ", enter your move (x y): ";
-                    std::cin >> x >> y;
+    int boardSize() const {
+        return header ? header->boardSize : 0;
+    }
 
-                    if (std::cin.fail()) {
-                        std::cin.clear();
-                        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-                        std::cerr << "Invalid input. Please enter numeric coordinates." << std::endl;
-                        continue;
-                    }
+    std::uint64_t slotCount() const {
+        return header ? header->slotCount : 0;
+    }
 
-                    if (board.isValidMove(x, y)) {
+    // Raw slot access for offline tools: false for an empty slot, otherwise the canonical key and its info byte
+    bool slot(std::uint64_t index, std::uint64_t& key, std::uint8_t& slotInfo) const {
+        if (keys[index] == 0) return false;
+        key = keys[index] - 1;
+        slotInfo = info[index];
+        return true;
+    }
+
+    // Looks the position up with `toMove` to play; on success sets whether that side wins and a best move in board
+    // coordinates. The table holds positions in the frame where BLUE joins left and right and moves whenever both
+    // colours have as many stones. After a swap the counts say the opposite, so the position is mirrored
+    // (x, y) -> (y, x) with the colours exchanged, which keeps every edge and the winner and restores the count.
+    bool lookup(const Board& board, BluePath bluePath, Player toMove, bool& toMoveWins,
+                std::pair<int, int>& best) const {
+        const int size = board.getSize();
+        if (header == nullptr || size != header->boardSize) return false;
+        bool transposed = bluePath != BluePath::LEFT_TO_RIGHT;
+        bool exchanged = false;
+        std::uint64_t blue = 0, red = 0;
+        frameStones(board, transposed, exchanged, blue, red);
+        if (SmallBoardSolver::blueToMove(blue, red) != (toMove == Player::BLUE)) {
+            transposed = !transposed;
+            exchanged = true;
+            frameStones(board, transposed, exchanged, blue, red);
+            if (SmallBoardSolver::blueToMove(blue, red) != (toMove == Player::RED)) return false;
+        }
+        bool rotated;
+        std::uint64_t key = smallBoardKey(blue, red, size, rotated);
+        for (std::uint64_t slot = perfectTableSlot(key, header->slotCount);; slot = (slot + 1) & (header->slotCount - 1)) {
+            if (keys[slot] == 0) return false;
+            if (keys[slot] == key + 1) {
+                int cell = info[slot] & 0x3F;
+                if (rotated) cell = size * size - 1 - cell;
+                best = transposed ? std::make_pair(cell % size, cell / size) : std::make_pair(cell / size, cell % size);
+                toMoveWins = (info[slot] & 0x80) != 0;
+                return true;
+            }
+        }
+    }
+
+private:
+    // Stone masks of the board in the table frame: cell x * size + y, or y * size + x when transposed, and the
+    // colours swapped when exchanged
+    static void frameStones(const Board& board, bool transposed, bool exchanged, std::uint64_t& blue,
+                            std::uint64_t& red) {
+        const int size = board.getSize();
+        blue = red = 0;
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                int cell = transposed ? y * size + x : x * size + y;
+                Player stone = board.getPlayerAt(x, y);
+                if (stone == Player::BLANK) continue;
+                if ((stone == Player::BLUE) != exchanged) blue |= SmallBoardSolver::cellBit(cell);
+                else red |= SmallBoardSolver::cellBit(cell);
+            }
+        }
+    }
+};
+
+// Solves every position reachable by legal play with at most `maxStones` stones (no earlier winner) and writes the
+// table; returns the number of positions stored
+long long buildPerfectTable(int size, int maxStones, const std::string& path) {
+    SmallBoardSolver solver(size);
+    std::vector<std::pair<std::uint64_t, std::uint8_t>> entries;
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> layer(1, {0, 0});
+
+    // Breadth-first by stone count so duplicates within a layer can be removed with one sort
+    for (int stones = 0; stones <= maxStones && !layer.empty(); ++stones) {
+        std::vector<std::pair<std::uint64_t, std::pair<std::uint64_t, std::uint64_t>>> keyed;
+        for (const auto& position : layer) {
+            bool rotated;
+            keyed.push_back({smallBoardKey(position.first, position.second, size, rotated), position});
+        }
+        std::sort(keyed.begin(), keyed.end());
+        keyed.erase(std::unique(keyed.begin(), keyed.end(),
+                                [](const auto& a, const auto& b) { return a.first == b.first; }),
+                    keyed.end());
+
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> next;
+        for (const auto& item : keyed) {
+            std::uint64_t blue = item.second.first, red = item.second.second;
+            bool rotated;
+            std::uint64_t key = smallBoardKey(blue, red, size, rotated);
+            int best;
+            bool wins = solver.solve(blue, red, best);
+            int stored = rotated ? size * size - 1 - best : best;
+            entries.push_back({key, static_cast<std::uint8_t>((wins ? 0x80 : 0) | stored)});
+
+            if (stones == maxStones) continue;
+            const bool blueMoves = SmallBoardSolver::blueToMove(blue, red);
+            for (int cell = 0; cell < size * size; ++cell) {
+                std::uint64_t bit = SmallBoardSolver::cellBit(cell);
+                if ((blue | red) & bit) continue;
+                std::uint64_t nb = blueMoves ? blue | bit : blue;
+                std::uint64_t nr = blueMoves ? red : red | bit;
+                if (solver.connects(blueMoves ? nb : nr, blueMoves)) continue; // game over, never looked up
+                next.push_back({nb, nr});
+            }
+        }
+        layer.swap(next);
+        std::cout << "stones " << stones << ": " << keyed.size() << " positions" << std::endl;
+    }
+
+    std::uint64_t slotCount = 1;
+    while (slotCount < entries.size() * 2) slotCount <<= 1;
+    std::vector<std::uint64_t> keys(slotCount, 0);
+    std::vector<std::uint8_t> info(slotCount, 0);
+    for (const auto& entry : entries) {
+        std::uint64_t slot = perfectTableSlot(entry.first, slotCount);
+        while (keys[slot] != 0) slot = (slot + 1) & (slotCount - 1);
+        keys[slot] = entry.first + 1;
+        info[slot] = entry.second;
+    }
+
+    PerfectTableHeader header = PerfectTableHeader();
+    std::memcpy(header.magic, "HEXT", 4);
+    header.version = 1;
+    header.boardSize = static_cast<std::uint8_t>(size);
+    header.maxStones = static_cast<std::uint16_t>(maxStones);
+    header.slotCount = slotCount;
+    header.entryCount = entries.size();
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(keys.data()), static_cast<std::streamsize>(slotCount * sizeof(std::uint64_t)));
+    out.write(reinterpret_cast<const char*>(info.data()), static_cast<std::streamsize>(slotCount));
+    return out ? static_cast<long long>(entries.size()) : -1;
+}
+
+//Position Database: what happened from a position in archived games, behind a sorted memory-mapped index
+// Positions are Zobrist-hashed in the frame where BLUE joins the left and right edges. The four symmetries of Hex
+// (identity, the 180 degree rotation, and the mirror (x, y) -> (y, x) with colours and side to move exchanged, plain
+// or rotated) are hashed together and the smallest hash names the position. Statistics are kept for the side to
+// move: games through the position, games it won, and the reply that won most often.
+class PositionHasher {
+public:
+    static const int maxSize = 19;
+
+private:
+    std::uint64_t stones[2][maxSize * maxSize]; // [colour][x * maxSize + y]
+    std::uint64_t sizes[maxSize + 1];
+    std::uint64_t blueToMove;
+
+public:
+    PositionHasher() {
+        std::uint64_t state = 0x484558445A4F4252ULL; // fixed, so every build hashes alike
+        for (auto& colour : stones) {
+            for (std::uint64_t& key : colour) key = splitMix64(state);
+        }
+        for (std::uint64_t& key : sizes) key = splitMix64(state);
+        blueToMove = splitMix64(state);
+    }
+
+    static const PositionHasher& instance() {
+        static const PositionHasher hasher;
+        return hasher;
+    }
+
+    // Maps a cell through symmetry `s` (each one is its own inverse); s >= 2 also exchanges the colours
+    static std::pair<int, int> map(int s, int size, int x, int y) {
+        switch (s) {
+            case 1: return {size - 1 - x, size - 1 - y};
+            case 2: return {y, x};
+            case 3: return {size - 1 - y, size - 1 - x};
+            default: return {x, y};
+        }
+    }
+
+    // Canonical hash of the position with `toMove` to play; `symmetry` receives the symmetry that produced it
+    std::uint64_t hash(const Board& board, BluePath bluePath, Player toMove, int& symmetry) const {
+        const int size = board.getSize();
+        std::uint64_t h[4];
+        for (int s = 0; s < 4; ++s) {
+            bool blueMoves = (toMove == Player::BLUE) != (s >= 2);
+            h[s] = sizes[size] ^ (blueMoves ? blueToMove : 0);
+        }
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                Player stone = board.getPlayerAt(x, y);
+                if (stone == Player::BLANK) continue;
+                // Into the frame where BLUE joins the left and right edges
+                const int cx = bluePath == BluePath::LEFT_TO_RIGHT ? x : y;
+                const int cy = bluePath == BluePath::LEFT_TO_RIGHT ? y : x;
+                const int colour = stone == Player::BLUE ? 0 : 1;
+                for (int s = 0; s < 4; ++s) {
+                    std::pair<int, int> cell = map(s, size, cx, cy);
+                    h[s] ^= stones[s >= 2 ? 1 - colour : colour][cell.first * maxSize + cell.second];
+                }
+            }
+        }
+        symmetry = 0;
+        for (int s = 1; s < 4; ++s) {
+            if (h[s] < h[symmetry]) symmetry = s;
+        }
+        return h[symmetry];
+    }
+
+    // A board cell as a canonical cell index under `symmetry`, and back
+    static int toCanonical(int symmetry, int size, BluePath bluePath, std::pair<int, int> move) {
+        if (bluePath == BluePath::TOP_TO_BOTTOM) std::swap(move.first, move.second);
+        std::pair<int, int> cell = map(symmetry, size, move.first, move.second);
+        return cell.first * size + cell.second;
+    }
+
+    static std::pair<int, int> fromCanonical(int symmetry, int size, BluePath bluePath, int index) {
+        std::pair<int, int> cell = map(symmetry, size, index / size, index % size);
+        if (bluePath == BluePath::TOP_TO_BOTTOM) std::swap(cell.first, cell.second);
+        return cell;
+    }
+};
+
+// Index file: header, 65537 bucket starts (entries whose hash begins with each 16-bit prefix), then entries sorted by
+// hash
+struct PositionDbHeader {
+    char magic[4];       // "HEXD"
+    std::uint8_t version;
+    std::uint8_t reserved[3];
+    std::uint32_t games;
+    std::uint32_t reservedWord;
+    std::uint64_t entryCount;
+    std::uint64_t positions;
+};
+static_assert(sizeof(PositionDbHeader) == 32, "PositionDbHeader must stay 32 bytes");
+
+struct PositionDbEntry {
+    std::uint64_t hash;
+    std::uint32_t visits;      // games through the position
+    std::uint32_t wins;        // of those, won by the side to move
+    std::uint32_t replyVisits; // games in which the side to move chose `reply`
+    std::uint32_t replyWins;
+    std::uint16_t reply;       // canonical cell index of the most successful reply
+    std::uint16_t reserved;
+    std::uint32_t reservedWord;
+};
+static_assert(sizeof(PositionDbEntry) == 32, "PositionDbEntry must stay 32 bytes");
+
+class PositionDatabase {
+public:
+    static const int bucketCount = 65536;
+
+    // A hit, with the reply in board coordinates
+    struct Stats {
+        std::uint32_t visits;
+        std::uint32_t wins;
+        std::pair<int, int> reply;
+        std::uint32_t replyVisits;
+        std::uint32_t replyWins;
+    };
+
+private:
+    MappedFile file;
+    const PositionDbHeader* header;
+    const std::uint64_t* buckets;
+    const PositionDbEntry* entries;
+
+public:
+    explicit PositionDatabase(const std::string& path) : file(path), header(nullptr), buckets(nullptr), entries(nullptr) {
+        const std::size_t prefix = sizeof(PositionDbHeader) + (bucketCount + 1) * sizeof(std::uint64_t);
+        if (file.size() < prefix) return;
+        const PositionDbHeader* candidate = reinterpret_cast<const PositionDbHeader*>(file.data());
+        if (std::memcmp(candidate->magic, "HEXD", 4) != 0 || candidate->version != 1 ||
+            file.size() < prefix + candidate->entryCount * sizeof(PositionDbEntry)) {
+            return;
+        }
+        header = candidate;
+        buckets = reinterpret_cast<const std::uint64_t*>(file.data() + sizeof(PositionDbHeader));
+        entries = reinterpret_cast<const PositionDbEntry*>(file.data() + prefix);
+    }
+
+    bool isOpen() const {
+        return header != nullptr;
+    }
+
+    std::uint64_t entryCount() const {
+        return header ? header->entryCount : 0;
+    }
+
+    // Entry for a canonical hash, or nullptr; a bucket holds entryCount / 65536 entries on average
+    const PositionDbEntry* find(std::uint64_t hash) const {
+        const PositionDbEntry* first = entries + buckets[hash >> 48];
+        const PositionDbEntry* last = entries + buckets[(hash >> 48) + 1];
+        const PositionDbEntry* it = std::lower_bound(first, last, hash, [](const PositionDbEntry& entry, std::uint64_t key) {
+            return entry.hash < key;
+        });
+        return it != last && it->hash == hash ? it : nullptr;
+    }
+
+    bool lookup(const Board& board, BluePath bluePath, Player toMove, Stats& stats) const {
+        if (header == nullptr || board.getSize() > PositionHasher::maxSize) return false;
+        int symmetry;
+        const PositionDbEntry* entry = find(PositionHasher::instance().hash(board, bluePath, toMove, symmetry));
+        if (entry == nullptr) return false;
+        stats.visits = entry->visits;
+        stats.wins = entry->wins;
+        stats.reply = PositionHasher::fromCanonical(symmetry, board.getSize(), bluePath, entry->reply);
+        stats.replyVisits = entry->replyVisits;
+        stats.replyWins = entry->replyWins;
+        return true;
+    }
+};
+
+// One observation while building: a position, the reply played from it and whether the side to move went on to win.
+// Observations are sorted in memory-sized runs on disk and merged, so archives far larger than memory still build.
+struct PositionObservation {
+    std::uint64_t hash;
+    std::uint16_t reply;
+    std::uint8_t won;
+    std::uint8_t reserved[5];
+
+    bool operator<(const PositionObservation& other) const {
+        return hash != other.hash ? hash < other.hash : reply < other.reply;
+    }
+};
+static_assert(sizeof(PositionObservation) == 16, "PositionObservation must stay 16 bytes");
+
+// Builds the index from a game archive; returns the number of distinct positions, or -1 on an I/O failure
+long long buildPositionDatabase(const std::string& archivePath, const std::string& outputPath,
+                                std::size_t runObservations = std::size_t(1) << 22) {
+    GameRecordReader reader(archivePath);
+    if (!reader.isOpen()) {
+        std::cerr << "Cannot open record file " << archivePath << std::endl;
+        return -1;
+    }
+    const PositionHasher& hasher = PositionHasher::instance();
+    std::vector<std::string> runPaths;
+    std::vector<PositionObservation> run;
+    run.reserve(runObservations);
+    auto flushRun = [&]() {
+        if (run.empty()) return true;
+        std::sort(run.begin(), run.end());
+        runPaths.push_back(outputPath + ".run" + std::to_string(runPaths.size()));
+        std::ofstream out(runPaths.back(), std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(run.data()), static_cast<std::streamsize>(run.size() * sizeof(run[0])));
+        run.clear();
+        return static_cast<bool>(out);
+    };
+
+    std::uint32_t games = 0;
+    std::uint64_t positions = 0;
+    GameView game;
+    while (reader.next(game)) {
+        const int size = game.header->boardSize;
+        if (game.header->winner > 1 || size > PositionHasher::maxSize) continue; // no result to learn from
+        const BluePath bluePath = static_cast<BluePath>(game.header->bluePath);
+        const Player winner = game.header->winner == 0 ? Player::BLUE : Player::RED;
+        Board board(size);
+        for (int i = 0; i < game.header->moveCount; ++i) {
+            const Player toMove = i == 0 ? Player::BLUE : (game.colour(i - 1) == Player::BLUE ? Player::RED : Player::BLUE);
+            PositionObservation observation = PositionObservation();
+            int symmetry;
+            observation.hash = hasher.hash(board, bluePath, toMove, symmetry);
+            observation.reply = static_cast<std::uint16_t>(PositionHasher::toCanonical(symmetry, size, bluePath, game.move(i)));
+            observation.won = toMove == winner ? 1 : 0;
+            run.push_back(observation);
+            if (run.size() == runObservations && !flushRun()) return -1;
+            const std::pair<int, int> stone = game.stone(i);
+            board.makeMove(stone.first, stone.second, game.colour(i));
+        }
+        ++games;
+        positions += game.header->moveCount;
+    }
+    if (!flushRun()) return -1;
+
+    // k-way merge of the sorted runs; equal (hash, reply) pairs arrive together, equal hashes next to each other
+    struct RunReader {
+        std::ifstream in;
+        PositionObservation current;
+        bool next() {
+            return static_cast<bool>(in.read(reinterpret_cast<char*>(&current), sizeof(current)));
+        }
+    };
+    std::vector<std::unique_ptr<RunReader>> readers;
+    auto later = [&readers](std::size_t a, std::size_t b) { return readers[b]->current < readers[a]->current; };
+    std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(later)> heads(later);
+    for (const std::string& path : runPaths) {
+        readers.emplace_back(new RunReader{std::ifstream(path, std::ios::binary), PositionObservation()});
+        if (readers.back()->next()) heads.push(readers.size() - 1);
+    }
+
+    std::ofstream out(outputPath, std::ios::binary | std::ios::trunc);
+    std::vector<std::uint64_t> buckets(PositionDatabase::bucketCount + 1, 0);
+    const std::streamoff entriesStart = sizeof(PositionDbHeader) + buckets.size() * sizeof(std::uint64_t);
+    out.seekp(entriesStart);
+    std::uint64_t entryCount = 0;
+    PositionDbEntry entry = PositionDbEntry();
+    std::uint32_t replyVisits = 0, replyWins = 0;
+    bool open = false;
+    auto closeReply = [&](std::uint16_t reply) {
+        // Most wins first, then most games
+        if (replyWins > entry.replyWins || (replyWins == entry.replyWins && replyVisits > entry.replyVisits)) {
+            entry.reply = reply;
+            entry.replyVisits = replyVisits;
+            entry.replyWins = replyWins;
+        }
+        replyVisits = replyWins = 0;
+    };
+    auto closeEntry = [&]() {
+        out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        ++buckets[(entry.hash >> 48) + 1];
+        ++entryCount;
+    };
+    PositionObservation previous = PositionObservation();
+    while (!heads.empty()) {
+        std::size_t index = heads.top();
+        heads.pop();
+        const PositionObservation observation = readers[index]->current;
+        if (readers[index]->next()) heads.push(index);
+
+        if (open && (observation.hash != previous.hash || observation.reply != previous.reply)) closeReply(previous.reply);
+        if (open && observation.hash != previous.hash) {
+            closeEntry();
+            open = false;
+        }
+        if (!open) {
+            entry = PositionDbEntry();
+            entry.hash = observation.hash;
+            open = true;
+        }
+        ++entry.visits;
+        entry.wins += observation.won;
+        ++replyVisits;
+        replyWins += observation.won;
+        previous = observation;
+    }
+    if (open) {
+        closeReply(previous.reply);
+        closeEntry();
+    }
+    for (std::size_t i = 1; i < buckets.size(); ++i) buckets[i] += buckets[i - 1]; // counts -> starts
+
+    PositionDbHeader header = PositionDbHeader();
+    std::memcpy(header.magic, "HEXD", 4);
+    header.version = 1;
+    header.games = games;
+    header.entryCount = entryCount;
+    header.positions = positions;
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(buckets.data()), static_cast<std::streamsize>(buckets.size() * sizeof(std::uint64_t)));
+    readers.clear();
+    for (const std::string& path : runPaths) std::remove(path.c_str());
+    std::cout << "Indexed " << entryCount << " positions (" << positions << " visited in " << games << " games, "
+              << runPaths.size() << " sorted runs)" << std::endl;
+    return out ? static_cast<long long>(entryCount) : -1;
+}
+
+// Lookup throughput over every position of an archive: canonical hashing plus the index probe, then the probe alone
+void benchPositionDatabase(const std::string& dbPath, const std::string& archivePath) {
+    PositionDatabase database(dbPath);
+    GameRecordReader reader(archivePath);
+    if (!database.isOpen() || !reader.isOpen()) {
+        std::cerr << "Cannot open " << (database.isOpen() ? archivePath : dbPath) << std::endl;
+        return;
+    }
+    std::vector<std::pair<Board, std::pair<BluePath, Player>>> queries; // boards are big, so a sample is kept
+    GameView game;
+    while (reader.next(game) && queries.size() < 20000) {
+        const BluePath bluePath = static_cast<BluePath>(game.header->bluePath);
+        Board board(game.header->boardSize);
+        for (int i = 0; i < game.header->moveCount; ++i) {
+            const Player toMove = i == 0 ? Player::BLUE : (game.colour(i - 1) == Player::BLUE ? Player::RED : Player::BLUE);
+            queries.push_back({board, {bluePath, toMove}});
+            const std::pair<int, int> stone = game.stone(i);
+            board.makeMove(stone.first, stone.second, game.colour(i));
+        }
+    }
+    long long hits = 0;
+    std::vector<std::uint64_t> hashes;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& query : queries) {
+        PositionDatabase::Stats stats;
+        int symmetry;
+        hashes.push_back(PositionHasher::instance().hash(query.first, query.second.first, query.second.second, symmetry));
+        hits += database.lookup(query.first, query.second.first, query.second.second, stats);
+    }
+    double fullSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const int rounds = 100;
+    long long probed = 0;
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (std::uint64_t hash : hashes) probed += database.find(hash) != nullptr;
+    }
+    double probeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << queries.size() << " positions, " << hits << " found; " << std::fixed << std::setprecision(2)
+              << queries.size() / fullSeconds / 1e6 << " M lookups/s from boards, "
+              << rounds * hashes.size() / probeSeconds / 1e6 << " M probes/s from hashes (" << probed
+              << " hits)" << std::defaultfloat << std::endl;
+}
+
+//Resistance Evaluation: the board as an electrical circuit, solved with preconditioned conjugate gradients
+// For one player every empty cell is a unit resistor, own stones conduct perfectly and opponent stones are cut out.
+// Adjacent cells are joined by conductance 1 / (r_i + r_j), and the player's two edges are held at potentials 1 and
+// 0. The lower the resistance between the edges, the stronger the player's connection. A chain of own stones has no
+// resistance, so it becomes a single node, which keeps the system well conditioned.
+// The current is read from the energy functional 2 b.x - x.A.x, whose error is the squared energy-norm error of the
+// potentials, so it is accurate long before the residual is small. Each CG step lowers that squared error by
+// alpha * r.z, and the solve stops once a step gains less than `tolerance` of the current. One extra stone only
+// moves the potentials near it, so a solve warm-started from the parent position's potentials stops after a few
+// steps.
+class ResistanceEvaluator {
+private:
+    int size;
+    std::vector<std::array<int, 6>> neighbours; // cell indices, -1 off the board
+    // Scratch for one solve, kept between calls
+    std::vector<int> unknown;                           // cell -> unknown index, -1 for fixed or cut-out cells
+    std::vector<int> chain;                             // cell -> chain id for own stones
+    std::vector<std::vector<std::pair<int, double>>> rows; // off-diagonal conductances per unknown
+    std::vector<double> diagonal, rhs, sourceConductance, solution, residual, direction, product;
+
+public:
+    static constexpr double tolerance = 3e-5; // relative gain in the current below which a solve ends
+    static constexpr double leak = 1e-9;      // conductance to ground so regions cut off from both edges stay solvable
+    static constexpr double cap = 1e6;        // resistances are clamped to [1 / cap, cap] for evaluation
+    static const int maxIterations = 2000;
+
+    struct Result {
+        double resistance; // between the player's edges: 0 once they are joined, infinity when cut apart
+        int iterations;
+    };
+
+    explicit ResistanceEvaluator(int size) : size(size), neighbours(size * size) {
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                for (int d = 0; d < 6; ++d) {
+                    int nx = x + hexDirections[d][0], ny = y + hexDirections[d][1];
+                    neighbours[x * size + y][d] = (nx >= 0 && nx < size && ny >= 0 && ny < size) ? nx * size + ny : -1;
+                }
+            }
+        }
+    }
+
+    // Solves the circuit of `player`. `potentials` holds the starting guess, one value per cell (a parent position's
+    // solution, or empty for a cold start), and receives the solution.
+    Result solve(const Board& board, Player player, BluePath bluePath, std::vector<double>& potentials) {
+        const int cells = size * size;
+        const bool acrossColumns = (player == Player::BLUE) == (bluePath == BluePath::LEFT_TO_RIGHT);
+        auto edgeOf = [&](int cell) { return acrossColumns ? cell % size : cell / size; };
+        std::vector<Player> stones(cells);
+        for (int cell = 0; cell < cells; ++cell) stones[cell] = board.getPlayerAt(cell / size, cell % size);
+        if (static_cast<int>(potentials.size()) != cells) potentials.assign(cells, 0.0);
+
+        // Own chains with the edges they touch; a chain on an edge takes that edge's potential
+        chain.assign(cells, -1);
+        std::vector<int> chainUnknown;
+        std::vector<double> chainValue; // fixed potential, or -1 while free
+        std::vector<int> stack;
+        for (int start = 0; start < cells; ++start) {
+            if (stones[start] != player || chain[start] >= 0) continue;
+            const int id = static_cast<int>(chainValue.size());
+            bool first = false, last = false;
+            stack.assign(1, start);
+            chain[start] = id;
+            while (!stack.empty()) {
+                int cell = stack.back();
+                stack.pop_back();
+                first = first || edgeOf(cell) == 0;
+                last = last || edgeOf(cell) == size - 1;
+                for (int other : neighbours[cell]) {
+                    if (other >= 0 && stones[other] == player && chain[other] < 0) {
+                        chain[other] = id;
+                        stack.push_back(other);
+                    }
+                }
+            }
+            if (first && last) {
+                for (int cell = 0; cell < cells; ++cell) potentials[cell] = chain[cell] == id ? 1.0 : 0.0;
+                return {0.0, 0}; // already connected
+            }
+            chainValue.push_back(first ? 1.0 : last ? 0.0 : -1.0);
+            chainUnknown.push_back(-1);
+        }
+
+        // Unknowns: every empty cell and every chain away from the edges
+        int count = 0;
+        unknown.assign(cells, -1);
+        for (int cell = 0; cell < cells; ++cell) {
+            if (stones[cell] == Player::BLANK) {
+                unknown[cell] = count++;
+            } else if (stones[cell] == player && chainValue[chain[cell]] < 0.0) {
+                int& index = chainUnknown[chain[cell]];
+                if (index < 0) index = count++;
+                unknown[cell] = index;
+            }
+        }
+        rows.resize(count);
+        for (int u = 0; u < count; ++u) rows[u].clear();
+        diagonal.assign(count, leak);
+        rhs.assign(count, 0.0);
+        sourceConductance.assign(count, 0.0);
+
+        // Conductances leave from empty cells only: empty-empty is 1/2, empty-stone 1, empty-edge 1
+        for (int cell = 0; cell < cells; ++cell) {
+            if (stones[cell] != Player::BLANK) continue;
+            const int u = unknown[cell];
+            for (int other : neighbours[cell]) {
+                if (other < 0 || (stones[other] != Player::BLANK && stones[other] != player)) continue;
+                const double g = stones[other] == Player::BLANK ? 0.5 : 1.0;
+                diagonal[u] += g;
+                if (unknown[other] >= 0) {
+                    rows[u].push_back({unknown[other], g});
+                    if (stones[other] == player) { // chains have no loop of their own, so mirror the entry
+                        rows[unknown[other]].push_back({u, g});
+                        diagonal[unknown[other]] += g;
+                    }
+                } else if (chainValue[chain[other]] > 0.0) {
+                    rhs[u] += g;
+                    sourceConductance[u] += g;
+                }
+            }
+            if (edgeOf(cell) == 0) {
+                diagonal[u] += 1.0;
+                rhs[u] += 1.0;
+                sourceConductance[u] += 1.0;
+            }
+            if (edgeOf(cell) == size - 1) {
+                diagonal[u] += 1.0;
+            }
+        }
+
+        // Warm start: each unknown begins at the mean of its cells' previous potentials
+        solution.assign(count, 0.0);
+        std::vector<int> members(count, 0);
+        for (int cell = 0; cell < cells; ++cell) {
+            if (unknown[cell] >= 0) {
+                solution[unknown[cell]] += potentials[cell];
+                ++members[unknown[cell]];
+            }
+        }
+        for (int u = 0; u < count; ++u) solution[u] /= std::max(1, members[u]);
+
+        // Jacobi-preconditioned conjugate gradients on the symmetric positive definite system
+        residual.resize(count);
+        direction.resize(count);
+        product.resize(count);
+        multiply(solution, product);
+        // The current leaving the potential-1 side is sum(b) - b.x for the exact solution; sum(b) - (b.x + x.r)
+        // overestimates it by exactly the squared energy-norm error of x
+        double sourceTotal = 0.0, energy = 0.0, rz = 0.0;
+        for (int u = 0; u < count; ++u) {
+            residual[u] = rhs[u] - product[u];
+            direction[u] = residual[u] / diagonal[u];
+            rz += residual[u] * direction[u];
+            sourceTotal += sourceConductance[u];
+            energy += solution[u] * (rhs[u] + residual[u]);
+        }
+        int iterations = 0;
+        while (iterations < maxIterations && rz > 0.0) {
+            multiply(direction, product);
+            double pAp = 0.0;
+            for (int u = 0; u < count; ++u) pAp += direction[u] * product[u];
+            const double alpha = rz / pAp;
+            double nextRz = 0.0;
+            energy = 0.0;
+            for (int u = 0; u < count; ++u) {
+                solution[u] += alpha * direction[u];
+                residual[u] -= alpha * product[u];
+                nextRz += residual[u] * residual[u] / diagonal[u];
+                energy += solution[u] * (rhs[u] + residual[u]);
+            }
+            const double gain = alpha * rz; // this step's drop in the squared energy-norm error
+            const double beta = nextRz / rz;
+            rz = nextRz;
+            for (int u = 0; u < count; ++u) {
+                direction[u] = residual[u] / diagonal[u] + beta * direction[u];
+            }
+            ++iterations;
+            if (gain <= tolerance * (sourceTotal - energy)) break;
+        }
+
+        const double current = sourceTotal - energy;
+        for (int cell = 0; cell < cells; ++cell) {
+            if (unknown[cell] >= 0) potentials[cell] = solution[unknown[cell]];
+            else if (stones[cell] == player) potentials[cell] = chainValue[chain[cell]];
+            else potentials[cell] = 0.0;
+        }
+        return {current > 0.0 ? 1.0 / current : std::numeric_limits<double>::infinity(), iterations};
+    }
+
+    // Positive when BLUE's circuit conducts better than RED's: log(R_red / R_blue) with clamped resistances.
+    // Each potential vector warm-starts its player's solve and is updated in place.
+    double evaluate(const Board& board, BluePath bluePath, std::vector<double>& bluePotentials,
+                    std::vector<double>& redPotentials, int* iterations = nullptr) {
+        Result blue = solve(board, Player::BLUE, bluePath, bluePotentials);
+        Result red = solve(board, Player::RED, bluePath, redPotentials);
+        if (iterations != nullptr) *iterations = blue.iterations + red.iterations;
+        auto clamp = [](double resistance) { return std::min(std::max(resistance, 1.0 / cap), cap); };
+        return std::log(clamp(red.resistance) / clamp(blue.resistance));
+    }
+
+private:
+    // out = A * in for the system built by the last solve
+    void multiply(const std::vector<double>& in, std::vector<double>& out) const {
+        for (size_t u = 0; u < rows.size(); ++u) {
+            double sum = diagonal[u] * in[u];
+            for (const auto& entry : rows[u]) sum -= entry.second * in[entry.first];
+            out[u] = sum;
+        }
+    }
+};
+
+// Cold versus warm-started resistance solves along a seeded random game; every position is evaluated both ways
+void benchResistance(int size, std::uint64_t seed) {
+    ResistanceEvaluator evaluator(size);
+    Board board(size);
+    std::vector<std::pair<int, int>> moves;
+    for (int x = 0; x < size; ++x) {
+        for (int y = 0; y < size; ++y) moves.emplace_back(x, y);
+    }
+    Xoroshiro128Plus rng(seed);
+    shuffleWith(moves, rng);
+
+    std::vector<double> warmBlue, warmRed;
+    evaluator.evaluate(board, BluePath::LEFT_TO_RIGHT, warmBlue, warmRed);
+    const int positions = static_cast<int>(moves.size()) / 2;
+    long long coldIterations = 0, warmIterations = 0;
+    double coldSeconds = 0.0, warmSeconds = 0.0, largestGap = 0.0;
+    Player toMove = Player::BLUE;
+    for (int i = 0; i < positions; ++i) {
+        board.makeMove(moves[i].first, moves[i].second, toMove);
+        toMove = toMove == Player::BLUE ? Player::RED : Player::BLUE;
+
+        std::vector<double> coldBlue, coldRed;
+        int iterations;
+        auto start = std::chrono::steady_clock::now();
+        double cold = evaluator.evaluate(board, BluePath::LEFT_TO_RIGHT, coldBlue, coldRed, &iterations);
+        auto middle = std::chrono::steady_clock::now();
+        coldIterations += iterations;
+        double warm = evaluator.evaluate(board, BluePath::LEFT_TO_RIGHT, warmBlue, warmRed, &iterations);
+        auto end = std::chrono::steady_clock::now();
+        warmIterations += iterations;
+        coldSeconds += std::chrono::duration<double>(middle - start).count();
+        warmSeconds += std::chrono::duration<double>(end - middle).count();
+        largestGap = std::max(largestGap, std::fabs(cold - warm));
+    }
+    std::cout << size << "x" << size << " over " << positions << " positions: cold " << std::fixed
+              << std::setprecision(1) << static_cast<double>(coldIterations) / positions << " iterations, "
+              << 1e6 * coldSeconds / positions << " us; warm " << static_cast<double>(warmIterations) / positions
+              << " iterations, " << 1e6 * warmSeconds / positions << " us; largest evaluation gap "
+              << std::scientific << std::setprecision(1) << largestGap << std::defaultfloat << std::endl;
+}
+
+//Heuristic Player: extends its own shortest path or blocks the opponent's, answering in microseconds
+// Chains live in a union-find with four virtual edge nodes, so a win is two find() calls away. For each player and each
+// of that player's edges, a 0-1 BFS distance map counts the empty cells still needed to reach the edge: own stones are
+// free and opponent stones are walls. An own stone can only shorten the mover's paths, so those maps are relaxed
+// outward from the new stone. An opponent stone can lengthen them, so those maps are rebuilt.
+class HeuristicPlayer {
+private:
+    static constexpr int unreachable = 1 << 20;
+
+    int size;
+    BluePath bluePath;
+    std::vector<Player> cells;
+    std::vector<int> parent; // union-find over the cells, then BLUE first/last and RED first/last edge nodes
+    std::vector<std::array<int, 6>> neighbours;
+    std::vector<int> distance[2][2]; // [player][edge][cell], the cell itself included
+    std::deque<int> work;
+
+public:
+    HeuristicPlayer(const Board& board, BluePath bluePath)
+        : size(board.getSize()), bluePath(bluePath), cells(size * size, Player::BLANK), parent(size * size + 4),
+          neighbours(size * size) {
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                for (int d = 0; d < 6; ++d) {
+                    int nx = x + hexDirections[d][0], ny = y + hexDirections[d][1];
+                    neighbours[x * size + y][d] = (nx >= 0 && nx < size && ny >= 0 && ny < size) ? nx * size + ny : -1;
+                }
+            }
+        }
+        for (size_t i = 0; i < parent.size(); ++i) parent[i] = static_cast<int>(i);
+        for (int cell = 0; cell < size * size; ++cell) {
+            Player stone = board.getPlayerAt(cell / size, cell % size);
+            if (stone != Player::BLANK) join(cell, stone);
+        }
+        for (int p = 0; p < 2; ++p) {
+            for (int edge = 0; edge < 2; ++edge) rebuild(p, edge);
+        }
+    }
+
+    bool isEmpty(int x, int y) const {
+        return cells[x * size + y] == Player::BLANK;
+    }
+
+    void play(int x, int y, Player player) {
+        const int cell = x * size + y;
+        join(cell, player);
+        const int mover = index(player);
+        for (int edge = 0; edge < 2; ++edge) {
+            relax(mover, edge, cell);
+            rebuild(1 - mover, edge);
+        }
+    }
+
+    bool hasWon(Player player) {
+        const int edges = size * size + 2 * index(player);
+        return find(edges) == find(edges + 1);
+    }
+
+    // Fewest empty cells the player still needs to connect its edges
+    int pathLength(Player player) const {
+        const int p = index(player);
+        int best = unreachable;
+        for (int cell = 0; cell < size * size; ++cell) {
+            if (edgeLine(p, cell) == size - 1) best = std::min(best, distance[p][0][cell]);
+        }
+        return best;
+    }
+
+    // Blocks when the opponent is strictly closer to connecting, otherwise extends; ties go to the more central cell
+    std::pair<int, int> bestMove(Player toMove) const {
+        const int me = index(toMove), other = 1 - me;
+        const bool block = pathLength(toMove == Player::BLUE ? Player::RED : Player::BLUE) < pathLength(toMove);
+        const double centre = (size - 1) / 2.0;
+        int best = -1;
+        long long bestKey = 0;
+        for (int cell = 0; cell < size * size; ++cell) {
+            if (cells[cell] != Player::BLANK) continue;
+            long long own = through(me, cell), theirs = through(other, cell);
+            long long primary = block ? theirs : own, secondary = block ? own : theirs;
+            double offset = std::fabs(cell / size - centre) + std::fabs(cell % size - centre);
+            long long key = (primary * 4 * unreachable + secondary) * 64 + static_cast<long long>(2 * offset);
+            if (best < 0 || key < bestKey) {
+                best = cell;
+                bestKey = key;
+            }
+        }
+        return best < 0 ? std::make_pair(-1, -1) : std::make_pair(best / size, best % size);
+    }
+
+private:
+    static int index(Player player) {
+        return player == Player::BLUE ? 0 : 1;
+    }
+
+    // Coordinate of the cell across the player's direction: 0 on its first edge, size - 1 on its last
+    int edgeLine(int p, int cell) const {
+        const bool acrossColumns = (p == 0) == (bluePath == BluePath::LEFT_TO_RIGHT);
+        return acrossColumns ? cell % size : cell / size;
+    }
+
+    int cost(int p, int cell) const {
+        Player stone = cells[cell];
+        if (stone == Player::BLANK) return 1;
+        return index(stone) == p ? 0 : unreachable;
+    }
+
+    // Empty cells on the player's best path through this cell
+    int through(int p, int cell) const {
+        int total = distance[p][0][cell] + distance[p][1][cell] - cost(p, cell);
+        return std::min(total, unreachable);
+    }
+
+    int find(int node) {
+        while (parent[node] != node) {
+            parent[node] = parent[parent[node]];
+            node = parent[node];
+        }
+        return node;
+    }
+
+    void unite(int a, int b) {
+        parent[find(a)] = find(b);
+    }
+
+    void join(int cell, Player player) {
+        cells[cell] = player;
+        const int p = index(player);
+        for (int other : neighbours[cell]) {
+            if (other >= 0 && cells[other] == player) unite(cell, other);
+        }
+        if (edgeLine(p, cell) == 0) unite(cell, size * size + 2 * p);
+        if (edgeLine(p, cell) == size - 1) unite(cell, size * size + 2 * p + 1);
+    }
+
+    // Full 0-1 BFS from one edge
+    void rebuild(int p, int edge) {
+        std::vector<int>& dist = distance[p][edge];
+        dist.assign(size * size, unreachable);
+        work.clear();
+        const int line = edge == 0 ? 0 : size - 1;
+        for (int cell = 0; cell < size * size; ++cell) {
+            int c = cost(p, cell);
+            if (edgeLine(p, cell) != line || c >= unreachable) continue;
+            dist[cell] = c;
+            if (c == 0) work.push_front(cell);
+            else work.push_back(cell);
+        }
+        propagate(p, dist);
+    }
+
+    // The cell just became an own stone: its distance drops by one and the decrease spreads outward
+    void relax(int p, int edge, int cell) {
+        std::vector<int>& dist = distance[p][edge];
+        if (dist[cell] >= unreachable) return;
+        dist[cell] -= 1;
+        work.clear();
+        work.push_back(cell);
+        propagate(p, dist);
+    }
+
+    void propagate(int p, std::vector<int>& dist) {
+        while (!work.empty()) {
+            int cell = work.front();
+            work.pop_front();
+            for (int other : neighbours[cell]) {
+                if (other < 0) continue;
+                int c = cost(p, other);
+                if (c >= unreachable || dist[cell] + c >= dist[other]) continue;
+                dist[other] = dist[cell] + c;
+                if (c == 0) work.push_front(other);
+                else work.push_back(other);
+            }
+        }
+    }
+};
+
+//Pre-search: immediate wins, forced blocks, double threats and the must-play region, from edge reachability alone
+// A cell wins at once for a player when it lies on or touches both of the player's edges, counting the player's
+// chains already joined to each edge. A move leaving two or more such cells is a double threat no single reply can
+// stop. If the opponent has one at cell c, then {c} plus the cells it threatens is a carrier of an opponent win, and
+// any reply outside it loses. Only the intersection of all such carriers is worth searching.
+class ThreatScanner {
+private:
+    int size;
+    std::vector<std::array<int, 6>> neighbours; // cell indices, -1 off the board
+
+public:
+    enum Kind {
+        OPEN,     // nothing forced, search every move
+        WIN,      // the move wins at once
+        BLOCK,    // the move stops the opponent's only immediate win (or one of several when the game is lost)
+        DOUBLE,   // the move leaves two immediate wins, which cannot both be stopped
+        REGION    // only the listed moves can stop the opponent's double threats
+    };
+
+    struct Result {
+        Kind kind;
+        std::vector<std::pair<int, int>> moves; // the forced move, or the must-play region
+    };
+
+    explicit ThreatScanner(int size) : size(size), neighbours(size * size) {
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                for (int d = 0; d < 6; ++d) {
+                    int nx = x + hexDirections[d][0], ny = y + hexDirections[d][1];
+                    neighbours[x * size + y][d] = (nx >= 0 && nx < size && ny >= 0 && ny < size) ? nx * size + ny : -1;
+                }
+            }
+        }
+    }
+
+    // Empty cells (x * size + y) where one more stone of `player` completes a winning chain
+    std::vector<int> winningCells(const std::vector<Player>& cells, Player player, BluePath bluePath) const {
+        const bool acrossColumns = (player == Player::BLUE) == (bluePath == BluePath::LEFT_TO_RIGHT);
+        std::vector<char> first = edgeReach(cells, player, acrossColumns, 0);
+        std::vector<char> last = edgeReach(cells, player, acrossColumns, size - 1);
+        std::vector<int> wins;
+        for (int cell = 0; cell < size * size; ++cell) {
+            if (cells[cell] == Player::BLANK && first[cell] && last[cell]) wins.push_back(cell);
+        }
+        return wins;
+    }
+
+    Result scan(const Board& board, BluePath bluePath, Player toMove) const {
+        const Player opponent = toMove == Player::BLUE ? Player::RED : Player::BLUE;
+        const int cells = size * size;
+        std::vector<Player> stones(cells);
+        for (int cell = 0; cell < cells; ++cell) stones[cell] = board.getPlayerAt(cell / size, cell % size);
+
+        std::vector<int> wins = winningCells(stones, toMove, bluePath);
+        if (!wins.empty()) return {WIN, {cellMove(wins[0])}};
+        std::vector<int> threats = winningCells(stones, opponent, bluePath);
+        if (!threats.empty()) return {BLOCK, {cellMove(threats[0])}};
+
+        std::vector<char> region(cells, 1);
+        bool carrierFound = false;
+        for (int cell = 0; cell < cells; ++cell) {
+            if (stones[cell] != Player::BLANK) continue;
+            stones[cell] = toMove;
+            if (winningCells(stones, toMove, bluePath).size() >= 2) {
+                stones[cell] = Player::BLANK;
+                return {DOUBLE, {cellMove(cell)}};
+            }
+            stones[cell] = opponent;
+            std::vector<int> replies = winningCells(stones, opponent, bluePath);
+            stones[cell] = Player::BLANK;
+            if (replies.size() >= 2) {
+                // Carrier {cell} + replies: everything else leaves the win intact
+                std::vector<char> carrier(cells, 0);
+                carrier[cell] = 1;
+                for (int reply : replies) carrier[reply] = 1;
+                for (int other = 0; other < cells; ++other) region[other] = region[other] && carrier[other];
+                carrierFound = true;
+            }
+        }
+
+        Result result{OPEN, {}};
+        if (!carrierFound) return result;
+        for (int cell = 0; cell < cells; ++cell) {
+            if (region[cell]) result.moves.push_back(cellMove(cell));
+        }
+        // An empty intersection means disjoint winning plans: the game is lost whatever we do, so search everything
+        if (!result.moves.empty()) result.kind = REGION;
+        return result;
+    }
+
+private:
+    std::pair<int, int> cellMove(int cell) const {
+        return {cell / size, cell % size};
+    }
+
+    // Cells on the given edge line or next to a chain of `player` that reaches it
+    std::vector<char> edgeReach(const std::vector<Player>& cells, Player player, bool acrossColumns, int line) const {
+        const int count = size * size;
+        std::vector<char> reached(count, 0), touching(count, 0);
+        std::vector<int> stack;
+        for (int cell = 0; cell < count; ++cell) {
+            if ((acrossColumns ? cell % size : cell / size) != line) continue;
+            touching[cell] = 1;
+            if (cells[cell] == player) {
+                reached[cell] = 1;
+                stack.push_back(cell);
+            }
+        }
+        while (!stack.empty()) {
+            int cell = stack.back();
+            stack.pop_back();
+            for (int other : neighbours[cell]) {
+                if (other < 0) continue;
+                touching[other] = 1;
+                if (cells[other] == player && !reached[other]) {
+                    reached[other] = 1;
+                    stack.push_back(other);
+                }
+            }
+        }
+        return touching;
+    }
+};
+
+//Virtual Connections: H-search over the hex graph, kept up to date move by move
+// For one player the nodes are empty cells, chains of the player's stones and the player's two edges. A full VC
+// between two nodes is a carrier of empty cells inside which the player can always join them, even moving second;
+// a semi VC needs one move first, at its key. Adjacent nodes start with empty carriers and edge templates II and IIIa
+// (the ziggurat) are seeded directly. The AND rule joins two disjoint VCs through a middle node: through a chain the
+// result is full, through an empty cell it is a semi VC keyed on that cell. The OR rule turns semi VCs whose carriers
+// have no cell in common into a full VC over their union.
+// After a move only the affected lists change: connections using a new opponent stone are dropped, and a new own
+// stone merges its nodes and promotes the semi VCs keyed on it. Only connections that are new or changed are fed back
+// through the rules.
+class VirtualConnections {
+public:
+    static constexpr int maxSize = 19;
+    using Carrier = std::bitset<maxSize * maxSize>; // bit x * size + y
+
+private:
+    static const int maxFull = 4;  // full VCs kept per pair of nodes, smallest carriers first
+    static const int maxSemi = 6;  // semi VCs kept per pair
+
+    struct Semi {
+        int key;
+        Carrier carrier; // includes the key
+    };
+
+    struct Lists {
+        std::vector<Carrier> full;
+        std::vector<Semi> semi;
+    };
+
+    struct Pending {
+        int a, b;
+        Carrier carrier;
+    };
+
+    int size;
+    int cells;
+    int nodes; // cells plus the two edge nodes
+    Player player;
+    BluePath bluePath;
+    std::vector<Player> stones;
+    std::vector<int> parent; // union-find over cells and edges; a chain touching an edge has the edge as its root
+    std::vector<std::array<int, 6>> neighbours;
+    std::vector<Lists> lists; // one per unordered pair of nodes
+    std::vector<Pending> queue;
+
+public:
+    static bool supports(int boardSize) {
+        return boardSize <= maxSize;
+    }
+
+    int getSize() const {
+        return size;
+    }
+
+    VirtualConnections(const Board& board, Player player, BluePath bluePath)
+        : size(board.getSize()), cells(size * size), nodes(cells + 2), player(player), bluePath(bluePath),
+          neighbours(cells) {
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                for (int d = 0; d < 6; ++d) {
+                    int nx = x + hexDirections[d][0], ny = y + hexDirections[d][1];
+                    neighbours[x * size + y][d] = (nx >= 0 && nx < size && ny >= 0 && ny < size) ? nx * size + ny : -1;
+                }
+            }
+        }
+        rebuild(board);
+    }
+
+    // Brings the connections up to `board`: new stones are played one by one, anything else (a new game) rebuilds
+    void sync(const Board& board) {
+        std::vector<int> added;
+        for (int cell = 0; cell < cells; ++cell) {
+            Player stone = board.getPlayerAt(cell / size, cell % size);
+            if (stone == stones[cell]) continue;
+            if (stones[cell] != Player::BLANK) {
+                rebuild(board);
+                return;
+            }
+            added.push_back(cell);
+        }
+        for (int cell : added) {
+            play(cell, board.getPlayerAt(cell / size, cell % size));
+        }
+    }
+
+    void play(int cell, Player stone) {
+        if (connected()) {
+            stones[cell] = stone;
+            return;
+        }
+        if (stone == player) {
+            playOwn(cell);
+        } else {
+            playOpponent(cell);
+        }
+        closure();
+    }
+
+    // The player's chains already join the two edges
+    bool connected() {
+        return find(cells) == find(cells + 1);
+    }
+
+    // A cell whose stone completes a full VC between the edges (the player wins by playing it), or -1
+    int winningMove() {
+        if (connected()) return -1;
+        const Lists& edges = pair(find(cells), find(cells + 1));
+        return edges.semi.empty() ? -1 : edges.semi.front().key;
+    }
+
+    // The player connects the edges even moving second
+    bool winning() {
+        return connected() || !pair(find(cells), find(cells + 1)).full.empty();
+    }
+
+    // Cells the opponent must play in to stop every win this player holds between the edges (full VCs, and semi VCs
+    // since this player moves next). Returns false when there is no such win; `region` may come back empty, which
+    // means no single reply stops them all.
+    bool mustPlay(Carrier& region) {
+        if (connected()) return false;
+        const Lists& edges = pair(find(cells), find(cells + 1));
+        if (edges.full.empty() && edges.semi.empty()) return false;
+        region.set();
+        for (const Carrier& carrier : edges.full) region &= carrier;
+        for (const Semi& semi : edges.semi) region &= semi.carrier;
+        return true;
+    }
+
+    // Calls visit(a, b, carrier, key) for every VC between two live nodes; the key is -1 for a full VC
+    template <typename Visit>
+    void forEachConnection(Visit visit) {
+        for (int a = 0; a < nodes; ++a) {
+            if (!live(a)) continue;
+            for (int b = a + 1; b < nodes; ++b) {
+                if (!live(b)) continue;
+                const Lists& between = pair(a, b);
+                for (const Carrier& carrier : between.full) visit(a, b, carrier, -1);
+                for (const Semi& semi : between.semi) visit(a, b, semi.carrier, semi.key);
+            }
+        }
+    }
+
+    // For every full VC with a two-cell carrier (bridges, template II), the cell to answer with when the opponent
+    // takes the other one; -1 elsewhere
+    void bridgeReplies(std::vector<int>& replies) {
+        replies.assign(cells, -1);
+        for (int a = 0; a < nodes; ++a) {
+            if (!live(a)) continue;
+            for (int b = a + 1; b < nodes; ++b) {
+                if (!live(b)) continue;
+                for (const Carrier& carrier : pair(a, b).full) {
+                    if (carrier.count() != 2) continue;
+                    int first = -1, second = -1;
+                    for (int cell = 0; cell < cells; ++cell) {
+                        if (!carrier.test(cell)) continue;
+                        if (first < 0) first = cell;
+                        else second = cell;
+                    }
+                    if (replies[first] < 0 && replies[second] < 0) {
+                        replies[first] = second;
+                        replies[second] = first;
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    int find(int node) {
+        while (parent[node] != node) {
+            parent[node] = parent[parent[node]];
+            node = parent[node];
+        }
+        return node;
+    }
+
+    // Edges always stay roots, so their node ids never change
+    void unite(int a, int b) {
+        a = find(a);
+        b = find(b);
+        if (a != b) parent[std::min(a, b)] = std::max(a, b);
+    }
+
+    // Coordinate of the cell across the player's direction: 0 on its first edge, size - 1 on its last
+    int edgeLine(int cell) const {
+        const bool acrossColumns = (player == Player::BLUE) == (bluePath == BluePath::LEFT_TO_RIGHT);
+        return acrossColumns ? cell % size : cell / size;
+    }
+
+    bool live(int node) {
+        if (node >= cells) return find(node) == node;
+        return stones[node] == Player::BLANK || (stones[node] == player && find(node) == node);
+    }
+
+    Lists& pair(int a, int b) {
+        return a < b ? lists[a * nodes + b] : lists[b * nodes + a];
+    }
+
+    void rebuild(const Board& board) {
+        stones.assign(cells, Player::BLANK);
+        parent.resize(nodes);
+        for (int node = 0; node < nodes; ++node) parent[node] = node;
+        lists.assign(static_cast<size_t>(nodes) * nodes, Lists());
+        queue.clear();
+
+        for (int cell = 0; cell < cells; ++cell) {
+            stones[cell] = board.getPlayerAt(cell / size, cell % size);
+        }
+        for (int cell = 0; cell < cells; ++cell) {
+            if (stones[cell] != player) continue;
+            for (int other : neighbours[cell]) {
+                if (other >= 0 && stones[other] == player) unite(cell, other);
+            }
+            if (edgeLine(cell) == 0) unite(cell, cells);
+            if (edgeLine(cell) == size - 1) unite(cell, cells + 1);
+        }
+        if (connected()) return;
+
+        for (int cell = 0; cell < cells; ++cell) {
+            if (stones[cell] != Player::BLANK && stones[cell] != player) continue;
+            for (int other : neighbours[cell]) {
+                if (other >= 0 && (stones[other] == Player::BLANK || stones[other] == player)) {
+                    addFull(find(cell), find(other), Carrier());
+                }
+            }
+            if (edgeLine(cell) == 0) addFull(find(cell), cells, Carrier());
+            if (edgeLine(cell) == size - 1) addFull(find(cell), cells + 1, Carrier());
+            seedTemplates(cell);
+        }
+        closure();
+    }
+
+    // Edge templates II and IIIa anchored at `cell`, written for the edge at row 0 as (row, column) offsets; the
+    // other edges use the 180 degree rotation and the transposition, both of which keep hex adjacency
+    void seedTemplates(int cell) {
+        static const int second[2][2] = {{-1, 0}, {-1, 1}};
+        static const int ziggurat[2][8][2] = {
+            {{0, 1}, {-1, 0}, {-1, 1}, {-1, 2}, {-2, 0}, {-2, 1}, {-2, 2}, {-2, 3}},
+            {{0, -1}, {-1, 1}, {-1, 0}, {-1, -1}, {-2, 2}, {-2, 1}, {-2, 0}, {-2, -1}}};
+        for (int edge = 0; edge < 2; ++edge) {
+            const int distance = edge == 0 ? edgeLine(cell) : size - 1 - edgeLine(cell);
+            if (distance == 1) {
+                addTemplate(cell, edge, second, 2);
+            } else if (distance == 2) {
+                addTemplate(cell, edge, ziggurat[0], 8);
+                addTemplate(cell, edge, ziggurat[1], 8);
+            }
+        }
+    }
+
+    void addTemplate(int cell, int edge, const int (*offsets)[2], int count) {
+        const bool acrossColumns = (player == Player::BLUE) == (bluePath == BluePath::LEFT_TO_RIGHT);
+        const int sign = edge == 0 ? 1 : -1;
+        Carrier carrier;
+        for (int i = 0; i < count; ++i) {
+            int dx = sign * offsets[i][0], dy = sign * offsets[i][1];
+            if (acrossColumns) std::swap(dx, dy);
+            int x = cell / size + dx, y = cell % size + dy;
+            if (x < 0 || x >= size || y < 0 || y >= size || stones[x * size + y] != Player::BLANK) return;
+            carrier.set(x * size + y);
+        }
+        addFull(find(cell), cells + edge, carrier);
+    }
+
+    // Keeps the carrier unless a kept one is a subset of it; kept supersets of it are dropped
+    bool addFull(int a, int b, const Carrier& carrier) {
+        if (a == b) return false;
+        Lists& list = pair(a, b);
+        for (const Carrier& kept : list.full) {
+            if ((kept & ~carrier).none()) return false;
+        }
+        list.full.erase(std::remove_if(list.full.begin(), list.full.end(),
+                                       [&](const Carrier& kept) { return (carrier & ~kept).none(); }),
+                        list.full.end());
+        if (!keepSmallest(list.full, carrier, maxFull, [](const Carrier& kept) { return kept.count(); })) return false;
+        queue.push_back({a, b, carrier});
+        return true;
+    }
+
+    bool addSemi(int a, int b, int key, const Carrier& carrier) {
+        if (a == b) return false;
+        Lists& list = pair(a, b);
+        for (const Carrier& kept : list.full) {
+            if ((kept & ~carrier).none()) return false;
+        }
+        for (const Semi& kept : list.semi) {
+            if ((kept.carrier & ~carrier).none()) return false;
+        }
+        list.semi.erase(std::remove_if(list.semi.begin(), list.semi.end(),
+                                       [&](const Semi& kept) { return (carrier & ~kept.carrier).none(); }),
+                        list.semi.end());
+        if (!keepSmallest(list.semi, Semi{key, carrier}, maxSemi,
+                          [](const Semi& kept) { return kept.carrier.count(); })) {
+            return false;
+        }
+        combineSemis(a, b, carrier);
+        return true;
+    }
+
+    // Adds `item` to a list capped at `limit`, evicting the largest carrier when that one is bigger
+    template <typename T, typename Measure>
+    static bool keepSmallest(std::vector<T>& list, const T& item, size_t limit, Measure measure) {
+        if (list.size() < limit) {
+            list.push_back(item);
+            return true;
+        }
+        auto largest = std::max_element(list.begin(), list.end(),
+                                        [&](const T& x, const T& y) { return measure(x) < measure(y); });
+        if (measure(*largest) <= measure(item)) return false;
+        *largest = item;
+        return true;
+    }
+
+    // OR rule: starting from the new semi VC, take in the others (smallest first) while they shrink the common
+    // intersection; once it is empty the union is a full VC
+    void combineSemis(int a, int b, const Carrier& added) {
+        std::vector<Semi> semis = pair(a, b).semi;
+        std::sort(semis.begin(), semis.end(),
+                  [](const Semi& x, const Semi& y) { return x.carrier.count() < y.carrier.count(); });
+        Carrier common = added, carriers = added;
+        for (const Semi& semi : semis) {
+            Carrier narrowed = common & semi.carrier;
+            if (narrowed == common) continue;
+            common = narrowed;
+            carriers |= semi.carrier;
+            if (common.none()) {
+                addFull(a, b, carriers);
+                return;
+            }
+        }
+    }
+
+    // AND rule for every queued full VC, with each endpoint in turn as the middle node
+    void closure() {
+        for (size_t next = 0; next < queue.size(); ++next) {
+            const Pending pending = queue[next];
+            const int a = find(pending.a), b = find(pending.b);
+            if (a == b || !live(a) || !live(b)) continue;
+            extend(b, a, pending.carrier);
+            extend(a, b, pending.carrier);
+        }
+        queue.clear();
+    }
+
+    // Joins VC(end, middle) with every full VC(middle, other) that is disjoint from it
+    void extend(int end, int middle, const Carrier& carrier) {
+        if (middle >= cells) return; // an edge is never a middle node
+        const bool empty = stones[middle] == Player::BLANK;
+        for (int other = 0; other < nodes; ++other) {
+            if (other == end || other == middle || !live(other)) continue;
+            const std::vector<Carrier> joined = pair(middle, other).full; // adding may reshape the list
+            for (const Carrier& next : joined) {
+                if ((carrier & next).any()) continue;
+                if (end < cells && next.test(end)) continue;
+                if (other < cells && carrier.test(other)) continue;
+                Carrier both = carrier | next;
+                if (empty) {
+                    both.set(middle);
+                    addSemi(end, other, middle, both);
+                } else {
+                    addFull(end, other, both);
+                }
+            }
+        }
+    }
+
+    // Every connection whose carrier holds the cell is broken, and the cell stops being a node
+    void playOpponent(int cell) {
+        stones[cell] = player == Player::BLUE ? Player::RED : Player::BLUE;
+        for (int a = 0; a < nodes; ++a) {
+            for (int b = a + 1; b < nodes; ++b) {
+                Lists& list = lists[a * nodes + b];
+                if (a == cell || b == cell) {
+                    list = Lists();
+                    continue;
+                }
+                const size_t before = list.full.size();
+                list.full.erase(std::remove_if(list.full.begin(), list.full.end(),
+                                               [&](const Carrier& kept) { return kept.test(cell); }),
+                                list.full.end());
+                list.semi.erase(std::remove_if(list.semi.begin(), list.semi.end(),
+                                               [&](const Semi& kept) { return kept.carrier.test(cell); }),
+                                list.semi.end());
+                // Room freed in a capped list: let the survivors combine again to refill it
+                if (list.full.size() != before) {
+                    for (const Carrier& kept : list.full) queue.push_back({a, b, kept});
+                }
+            }
+        }
+    }
+
+    // The cell joins its neighbouring chains (and edges) into one node that inherits all of their connections
+    void playOwn(int cell) {
+        std::vector<int> merged{cell};
+        for (int other : neighbours[cell]) {
+            if (other >= 0 && stones[other] == player) merged.push_back(find(other));
+        }
+        if (edgeLine(cell) == 0) merged.push_back(cells);
+        if (edgeLine(cell) == size - 1) merged.push_back(cells + 1);
+        std::sort(merged.begin(), merged.end());
+        merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+
+        std::vector<Lists> inherited(nodes);
+        for (int old : merged) {
+            for (int other = 0; other < nodes; ++other) {
+                if (other == old) continue;
+                Lists& list = pair(old, other);
+                if (std::find(merged.begin(), merged.end(), other) == merged.end()) {
+                    inherited[other].full.insert(inherited[other].full.end(), list.full.begin(), list.full.end());
+                    inherited[other].semi.insert(inherited[other].semi.end(), list.semi.begin(), list.semi.end());
+                }
+                list = Lists();
+            }
+        }
+
+        stones[cell] = player;
+        for (int old : merged) unite(old, cell);
+        if (connected()) return;
+        const int root = find(cell);
+
+        for (int other = 0; other < nodes; ++other) {
+            for (Carrier carrier : inherited[other].full) {
+                carrier.reset(cell);
+                addFull(root, other, carrier);
+            }
+            for (Semi semi : inherited[other].semi) {
+                semi.carrier.reset(cell);
+                if (semi.key == cell) addFull(root, other, semi.carrier);
+                else addSemi(root, other, semi.key, semi.carrier);
+            }
+        }
+
+        // Elsewhere the stone only helps: carriers lose the cell and semi VCs keyed on it become full
+        for (int a = 0; a < nodes; ++a) {
+            for (int b = a + 1; b < nodes; ++b) {
+                if (a == root || b == root) continue;
+                Lists& list = lists[a * nodes + b];
+                for (Carrier& carrier : list.full) {
+                    if (!carrier.test(cell)) continue;
+                    carrier.reset(cell);
+                    queue.push_back({a, b, carrier});
+                }
+                std::vector<Carrier> promoted;
+                for (Semi& semi : list.semi) {
+                    if (!semi.carrier.test(cell)) continue;
+                    semi.carrier.reset(cell);
+                    if (semi.key == cell) promoted.push_back(semi.carrier);
+                }
+                list.semi.erase(std::remove_if(list.semi.begin(), list.semi.end(),
+                                               [&](const Semi& kept) { return kept.key == cell; }),
+                                list.semi.end());
+                for (const Carrier& carrier : promoted) addFull(a, b, carrier);
+            }
+        }
+    }
+};
+
+//Move Priors: local-pattern weights fitted to archived games, looked up in a table at run time
+// A candidate cell is described from the mover's side by a single feature:
+//  - its six neighbours (empty, own or opponent; off the board counts as the stone of whoever owns that edge), read in
+//    a frame where the mover joins the left and right edges and merged with the 180 degree rotation;
+//  - its bridge status: none, makes a bridge to an own stone, saves an intruded own bridge, or intrudes an opponent
+//    bridge;
+//  - its distance to the nearer own edge (0, 1, 2, 3 or more).
+// Weights are Bradley-Terry strengths fitted with Hunter's MM updates: in every archived position the move played
+// beats every other legal move. An average move weighs about 1.
+struct PatternPriorsHeader {
+    char magic[4];              // "HEXP"
+    std::uint8_t version;
+    std::uint8_t reserved[3];
+    std::uint32_t featureCount;
+    std::uint32_t games;
+    std::uint32_t iterations;
+    std::uint32_t reservedWord;
+    std::uint64_t positions;
+};
+static_assert(sizeof(PatternPriorsHeader) == 32, "PatternPriorsHeader must stay 32 bytes");
+
+class PatternPriors {
+public:
+    static const int patterns = 729; // 3^6 neighbour states
+    static const int bridgeStates = 4;
+    static const int edgeBuckets = 4;
+    static const int featureCount = patterns * bridgeStates * edgeBuckets;
+
+private:
+    MappedFile file;
+    const PatternPriorsHeader* header;
+    const float* weights;
+
+public:
+    explicit PatternPriors(const std::string& path) : file(path), header(nullptr), weights(nullptr) {
+        if (file.size() < sizeof(PatternPriorsHeader)) return;
+        const PatternPriorsHeader* candidate = reinterpret_cast<const PatternPriorsHeader*>(file.data());
+        if (std::memcmp(candidate->magic, "HEXP", 4) != 0 || candidate->version != 1 ||
+            candidate->featureCount != static_cast<std::uint32_t>(featureCount) ||
+            file.size() < sizeof(PatternPriorsHeader) + featureCount * sizeof(float)) {
+            return;
+        }
+        header = candidate;
+        weights = reinterpret_cast<const float*>(file.data() + sizeof(PatternPriorsHeader));
+    }
+
+    bool isOpen() const {
+        return header != nullptr;
+    }
+
+    float weight(int feature) const {
+        return weights[feature];
+    }
+
+    float prior(const Board& board, BluePath bluePath, Player mover, int x, int y) const {
+        return weights[feature(board, bluePath, mover, x, y)];
+    }
+
+    static int feature(const Board& board, BluePath bluePath, Player mover, int x, int y) {
+        static const int ring[6][2] = {{-1, 0}, {-1, 1}, {0, 1}, {1, 0}, {1, -1}, {0, -1}}; // in order around a cell
+        const int size = board.getSize();
+        const bool acrossColumns = (mover == Player::BLUE) == (bluePath == BluePath::LEFT_TO_RIGHT);
+        int state[6];
+        for (int i = 0; i < 6; ++i) {
+            int dx = ring[i][0], dy = ring[i][1];
+            if (!acrossColumns) std::swap(dx, dy); // transposing keeps adjacency and turns the mover's edges sideways
+            state[i] = cellState(board, mover, acrossColumns, x + dx, y + dy);
+        }
+        int pattern = 0, rotated = 0;
+        for (int i = 5; i >= 0; --i) {
+            pattern = pattern * 3 + state[i];
+            rotated = rotated * 3 + state[(i + 3) % 6];
+        }
+
+        int bridge = 0;
+        for (int i = 0; i < 6; ++i) {
+            const int before = state[(i + 5) % 6], here = state[i], after = state[(i + 1) % 6];
+            if (before == 1 && after == 1 && here == 2) {
+                bridge = 2; // the opponent took the other cell of our bridge
+                break;
+            }
+            if (before == 2 && after == 2 && here == 0) bridge = 3;
+            if (bridge == 0 && here == 0 && after == 0) {
+                int dx = ring[i][0] + ring[(i + 1) % 6][0], dy = ring[i][1] + ring[(i + 1) % 6][1];
+                if (!acrossColumns) std::swap(dx, dy);
+                const int fx = x + dx, fy = y + dy;
+                if (fx >= 0 && fx < size && fy >= 0 && fy < size && board.getPlayerAt(fx, fy) == mover) bridge = 1;
+            }
+        }
+
+        const int line = acrossColumns ? y : x;
+        const int edge = std::min(3, std::min(line, size - 1 - line));
+        return (std::min(pattern, rotated) * bridgeStates + bridge) * edgeBuckets + edge;
+    }
+
+private:
+    // 0 empty, 1 own, 2 opponent; beyond an edge, the edge's owner
+    static int cellState(const Board& board, Player mover, bool acrossColumns, int x, int y) {
+        const int size = board.getSize();
+        const bool outX = x < 0 || x >= size, outY = y < 0 || y >= size;
+        if (outX || outY) return (acrossColumns ? outY : outX) ? 1 : 2;
+        Player stone = board.getPlayerAt(x, y);
+        if (stone == Player::BLANK) return 0;
+        return stone == mover ? 1 : 2;
+    }
+};
+
+// Fits the pattern weights to every position of the archived games and writes the table; returns the number of
+// positions used, or -1 when a file cannot be opened
+long long trainPatternPriors(const std::string& archivePath, const std::string& outputPath, int iterations) {
+    GameRecordReader reader(archivePath);
+    if (!reader.isOpen()) {
+        std::cerr << "Cannot open record file " << archivePath << std::endl;
+        return -1;
+    }
+    // Each position keeps the (feature, count) pairs of its legal moves and the feature that was played
+    std::vector<std::pair<int, int>> counts;
+    std::vector<size_t> firstCount;
+    std::vector<int> played;
+    std::vector<double> wins(PatternPriors::featureCount, 0.0);
+    std::vector<int> seen(PatternPriors::featureCount, 0);
+    std::uint32_t games = 0;
+    GameView game;
+    while (reader.next(game)) {
+        const int size = game.header->boardSize;
+        const BluePath bluePath = static_cast<BluePath>(game.header->bluePath);
+        Board board(size);
+        for (int i = 0; i < game.header->moveCount; ++i) {
+            const std::pair<int, int> move = game.move(i);
+            const Player mover = i == 0 ? Player::BLUE : game.colour(i);
+            firstCount.push_back(counts.size());
+            std::vector<int> features;
+            for (int x = 0; x < size; ++x) {
+                for (int y = 0; y < size; ++y) {
+                    if (board.isValidMove(x, y)) features.push_back(PatternPriors::feature(board, bluePath, mover, x, y));
+                }
+            }
+            std::sort(features.begin(), features.end());
+            for (size_t k = 0; k < features.size();) {
+                size_t end = k;
+                while (end < features.size() && features[end] == features[k]) ++end;
+                counts.push_back({features[k], static_cast<int>(end - k)});
+                seen[features[k]] = 1;
+                k = end;
+            }
+            const int chosen = PatternPriors::feature(board, bluePath, mover, move.first, move.second);
+            played.push_back(chosen);
+            wins[chosen] += 1.0;
+            const std::pair<int, int> stone = game.stone(i);
+            board.makeMove(stone.first, stone.second, game.colour(i));
+        }
+        ++games;
+    }
+    firstCount.push_back(counts.size());
+    const size_t positions = played.size();
+
+    // MM: gamma_f = (W_f + 1) / (sum over positions of c_f / E_j + 2 / (gamma_f + 1)), where E_j is the total
+    // strength of position j's moves; the extra win and loss against a player of strength 1 keep rare patterns near 1
+    std::vector<double> gamma(PatternPriors::featureCount, 1.0), denominator(PatternPriors::featureCount);
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        std::fill(denominator.begin(), denominator.end(), 0.0);
+        for (size_t j = 0; j < positions; ++j) {
+            double total = 0.0;
+            for (size_t k = firstCount[j]; k < firstCount[j + 1]; ++k) total += counts[k].second * gamma[counts[k].first];
+            for (size_t k = firstCount[j]; k < firstCount[j + 1]; ++k) {
+                denominator[counts[k].first] += counts[k].second / total;
+            }
+        }
+        for (int f = 0; f < PatternPriors::featureCount; ++f) {
+            if (seen[f]) gamma[f] = (wins[f] + 1.0) / (denominator[f] + 2.0 / (gamma[f] + 1.0));
+        }
+    }
+
+    // How often the played move carries the highest weight of its position
+    size_t topChoice = 0;
+    for (size_t j = 0; j < positions; ++j) {
+        double best = 0.0;
+        for (size_t k = firstCount[j]; k < firstCount[j + 1]; ++k) best = std::max(best, gamma[counts[k].first]);
+        if (gamma[played[j]] >= best) ++topChoice;
+    }
+
+    std::ofstream out(outputPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Cannot write prior table " << outputPath << std::endl;
+        return -1;
+    }
+    PatternPriorsHeader header = PatternPriorsHeader();
+    std::memcpy(header.magic, "HEXP", 4);
+    header.version = 1;
+    header.featureCount = PatternPriors::featureCount;
+    header.games = games;
+    header.iterations = static_cast<std::uint32_t>(iterations);
+    header.positions = positions;
+    std::vector<float> table(gamma.begin(), gamma.end());
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(float)));
+    std::cout << "Fitted " << std::count(seen.begin(), seen.end(), 1) << " patterns on " << positions << " positions from "
+              << games << " games; the played move has the top weight in " << std::fixed << std::setprecision(1)
+              << (positions ? 100.0 * topChoice / positions : 0.0) << "% of positions" << std::defaultfloat << std::endl;
+    return static_cast<long long>(positions);
+}
+
+//Time Management: spreads a game clock (plus increment) over the moves still to come
+// Each move gets a target and a hard limit. The search checks in between rounds: a clear decision stops well before
+// the target, and an unclear one may run on past it up to the limit.
+class TimeManager {
+private:
+    double remaining; // seconds left on the clock
+    double increment; // seconds added after every move
+    int movesPlayed;
+
+public:
+    static constexpr double reserve = 0.05;       // fraction of the clock never planned, for overheads
+    static constexpr double clearConfidence = 0.99; // best move beats the runner-up this surely: stop early
+    static constexpr double settledConfidence = 0.9; // enough to stop once the target is reached
+
+    struct Budget {
+        double target; // seconds the move should normally take
+        double limit;  // seconds it must never exceed
+    };
+
+    TimeManager(double totalSeconds = 0.0, double incrementSeconds = 0.0)
+        : remaining(totalSeconds), increment(incrementSeconds), movesPlayed(0) {}
+
+    double getRemaining() const {
+        return remaining;
+    }
+
+    // Budget for the next move. Hex games rarely fill the board, so about half of the empty cells are expected to be
+    // played (half of them by us); the first two moves get half a share since the opening matters least.
+    Budget plan(int emptyCells) const {
+        const double usable = std::max(0.0, remaining * (1.0 - reserve));
+        const double movesLeft = std::max(4.0, emptyCells / 4.0);
+        double target = usable / movesLeft + 0.8 * increment;
+        if (movesPlayed < 2) target *= 0.5;
+        const double limit = std::min(usable * 0.5 + 0.9 * increment, 3.0 * target);
+        return {std::min(target, limit), limit};
+    }
+
+    // Called between search rounds with the confidence that the current best move is the right one
+    static bool shouldStop(double elapsed, const Budget& budget, double confidence) {
+        if (elapsed >= budget.limit) return true;
+        if (confidence >= clearConfidence && elapsed >= 0.25 * budget.target) return true;
+        return elapsed >= budget.target && confidence >= settledConfidence;
+    }
+
+    void consumed(double seconds) {
+        remaining = remaining - seconds + increment;
+        ++movesPlayed;
+    }
+};
+
+class AIPlayer {
+private:
+    Player player;
+    Player opponent;
+    RandomStreams streams;
+    MoveStats lastStats; // statistics of the most recent getBestMove call
+    const PerfectPlayTable* table; // optional small-board oracle, not owned
+    TimeManager* clock;            // optional game clock, not owned; without one every move runs `simulations` trials
+
+public:
+    enum class Level { MONTE_CARLO, HEURISTIC };  // HEURISTIC answers with the shortest-path bot alone
+    enum class Playouts { RANDOM, HEURISTIC };    // HEURISTIC mixes the bot's moves into the random playouts
+    using Replies = std::array<std::vector<int>, 2>; // per player (BLUE, RED): cell -> answer that saves a bridge
+
+private:
+    Level level;
+    Playouts playouts;
+    bool useVcs; // prune with virtual connections and answer bridge intrusions in playouts
+    bool paired; // antithetic trials: every random fill is scored as dealt and with the colours swapped
+    const PatternPriors* priors; // optional learned pattern weights for playout replies, not owned
+    const PositionDatabase* positions; // optional archive statistics that seed the candidates, not owned
+    // Kept between moves so each one is an incremental update; shared by copies of the engine, which only run trials
+    std::shared_ptr<VirtualConnections> ownVcs, opponentVcs;
+    BluePath vcPath;
+
+public:
+    static const int simulations = 1000;//Number of Simulation For Slow Performance Change it to 100
+    static const int roundTrials = 8; // trials per candidate between time checks of a clocked search
+    static const int heuristicShare = 50; // percent of heuristic playout moves chosen by the bot
+    static constexpr float priorReply = 3.0f; // a playout answers next to the last move when a cell weighs this much
+    static const int databaseTrials = simulations / 4; // most trials a candidate's archive record can stand for
+
+    AIPlayer(Player player, std::uint64_t seed = RandomStreams::clockSeed())
+        : player(player), opponent(player == Player::BLUE ? Player::RED : Player::BLUE), streams(seed), lastStats(),
+          table(nullptr), clock(nullptr), level(Level::MONTE_CARLO), playouts(Playouts::RANDOM), useVcs(false),
+          paired(false), priors(nullptr), positions(nullptr), vcPath(BluePath::LEFT_TO_RIGHT) {}
+
+    void setTable(const PerfectPlayTable* perfectTable) {
+        table = perfectTable;
+    }
+
+    void setClock(TimeManager* gameClock) {
+        clock = gameClock;
+    }
+
+    void setLevel(Level engineLevel) {
+        level = engineLevel;
+    }
+
+    void setPlayouts(Playouts policy) {
+        playouts = policy;
+    }
+
+    void setVirtualConnections(bool enabled) {
+        useVcs = enabled;
+    }
+
+    void setPairedTrials(bool enabled) {
+        paired = enabled;
+    }
+
+    void setPriors(const PatternPriors* table) {
+        priors = table;
+    }
+
+    void setPositionDatabase(const PositionDatabase* database) {
+        positions = database;
+    }
+
+    Player getPlayer() const {
+        return player;
+    }
+
+    std::uint64_t getSeed() const {
+        return streams.getSeed();
+    }
+
+    const MoveStats& getLastStats() const {
+        return lastStats;
+    }
+
+    // Monte Carlo result for one candidate move
+    struct CandidateStats {
+        std::pair<int, int> move;
+        int wins;
+        int trials;
+
+        double winRate() const {
+            return trials > 0 ? static_cast<double>(wins) / trials : 0.0;
+        }
+    };
+
+    // Every legal move of the position in row-major order, with empty statistics
+    static std::vector<CandidateStats> listCandidates(const Board& board) {
+        int size = board.getSize();
+        std::vector<CandidateStats> candidates;
+
+        for (int i = 0; i < size; ++i) {
+            for (int j = 0; j < size; ++j) {
+                if (board.isValidMove(i, j)) {
+                    candidates.push_back({{i, j}, 0, 0});
+                }
+            }
+        }
+        return candidates;
+    }
+
+    // Runs the next `count` trials of candidate number `index`; trial numbers continue from stats.trials, so
+    // splitting the work into chunks (or across threads and ponder sessions) gives the same result as one call
+    void addTrials(const Board& board, BluePath bluePath, size_t index, CandidateStats& stats, int count,
+                   const Replies* replies = nullptr) const {
+        const std::uint32_t ply = static_cast<std::uint32_t>(board.stonesPlaced());
+        Board scratch = board; // the only copy: every trial is rolled back through the journal
+        const size_t mark = scratch.journalMark();
+        if (paired && playouts == Playouts::RANDOM && replies == nullptr && priors == nullptr) {
+            // Trials 2k and 2k + 1 are the two halves of fill k, so chunking still gives the same results
+            const int end = stats.trials + count;
+            for (int sim = stats.trials; sim < end;) {
+                scratch.placeStone(stats.move.first, stats.move.second, player);
+                Xoroshiro128Plus rng = streams.stream(ply, static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(sim / 2));
+                bool wins[2];
+                scorePairedFill(scratch, bluePath, rng, wins);
+                for (int half = sim % 2; half < 2 && sim < end; ++half, ++sim) {
+                    if (wins[half]) stats.wins++;
+                }
+                scratch.rollback(mark);
+            }
+            stats.trials += count;
+            return;
+        }
+        for (int sim = stats.trials; sim < stats.trials + count; ++sim) {
+            scratch.placeStone(stats.move.first, stats.move.second, player);
+            Xoroshiro128Plus rng = streams.stream(ply, static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(sim));
+            if (simulateRandomGame(scratch, bluePath, rng, replies)) {
+                stats.wins++;
+            }
+            scratch.rollback(mark);
+        }
+        stats.trials += count;
+    }
+
+    // Brings every legal move up to the given number of trials; only reads shared state, so it is safe to call
+    // from several threads at once. `warm` may carry statistics already gathered for this position, and `region`
+    // limits the search to a must-play region (warm statistics then no longer line up and are dropped).
+    std::vector<CandidateStats> analyze(const Board& board, BluePath bluePath, int trials,
+                                        const std::vector<CandidateStats>* warm = nullptr,
+                                        const std::vector<std::pair<int, int>>* region = nullptr,
+                                        const Replies* replies = nullptr) const {
+        std::vector<CandidateStats> candidates = startingCandidates(board, warm, region);
+
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (candidates[i].trials < trials) {
+                addTrials(board, bluePath, i, candidates[i], trials - candidates[i].trials, replies);
+            }
+        }
+        return candidates;
+    }
+
+    // Batch analysis: every candidate run to `trials` trials. With virtual connections on, the threat scanner's region
+    // and the bridge replies apply as in getBestMove; the position database seeds the statistics.
+    std::vector<CandidateStats> analyzePosition(Board board, BluePath bluePath, int trials) {
+        Replies replies;
+        const Replies* answers = nullptr;
+        std::vector<std::pair<int, int>> region;
+        if (useVcs && VirtualConnections::supports(board.getSize())) {
+            ThreatScanner::Result forced = ThreatScanner(board.getSize()).scan(board, bluePath, player);
+            if (forced.moves.size() != 1) {
+                applyVcs(board, bluePath, forced, replies);
+                answers = &replies;
+            }
+            if (forced.kind != ThreatScanner::OPEN) region = forced.moves;
+        }
+        std::vector<CandidateStats> seeded;
+        const std::vector<CandidateStats>* warm = nullptr;
+        if (positions != nullptr && region.empty() && seedFromDatabase(board, bluePath, seeded)) warm = &seeded;
+        return analyze(board, bluePath, trials, warm, region.empty() ? nullptr : &region, answers);
+    }
+
+    // Index of the candidate with the highest win rate (first one on ties)
+    static size_t bestCandidate(const std::vector<CandidateStats>& candidates) {
+        size_t best = 0;
+        for (size_t i = 1; i < candidates.size(); ++i) {
+            if (candidates[i].winRate() > candidates[best].winRate()) {
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    // Probability that the best candidate really beats the runner-up (normal approximation of the two win rates)
+    static double confidence(const std::vector<CandidateStats>& candidates, size_t best) {
+        const CandidateStats* second = nullptr;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (i != best && (second == nullptr || candidates[i].winRate() > second->winRate())) {
+                second = &candidates[i];
+            }
+        }
+        if (second == nullptr) return 1.0;
+        double p1 = candidates[best].winRate();
+        double p2 = second->winRate();
+        double variance = p1 * (1.0 - p1) / std::max(1, candidates[best].trials) +
+                          p2 * (1.0 - p2) / std::max(1, second->trials);
+        if (variance <= 0.0) return p1 > p2 ? 1.0 : 0.5;
+        return 0.5 * std::erfc(-(p1 - p2) / std::sqrt(2.0 * variance));
+    }
+
+    std::pair<int, int> getBestMove(Board board, BluePath bluePath, const std::vector<CandidateStats>* pondered = nullptr) {
+        const auto start = std::chrono::steady_clock::now();
+        bool wins;
+        std::pair<int, int> perfect;
+        if (table != nullptr && table->lookup(board, bluePath, player, wins, perfect)) {
+            lastStats.playouts = 0;
+            lastStats.winRate = wins ? 65535 : 0;
+            lastStats.candidates = 1;
+            if (clock != nullptr) clock->consumed(secondsSince(start));
+            return perfect;
+        }
+        if (level == Level::HEURISTIC) {
+            std::pair<int, int> move = HeuristicPlayer(board, bluePath).bestMove(player);
+            lastStats.playouts = 0;
+            lastStats.winRate = 32768;
+            lastStats.candidates = 1;
+            if (clock != nullptr) clock->consumed(secondsSince(start));
+            return move;
+        }
+        ThreatScanner::Result forced = ThreatScanner(board.getSize()).scan(board, bluePath, player);
+        Replies replies;
+        const bool vcs = useVcs && forced.moves.size() != 1 && VirtualConnections::supports(board.getSize());
+        if (vcs) {
+            applyVcs(board, bluePath, forced, replies);
+            pondered = nullptr; // pondering ran its trials without the bridge answers
+        }
+        if (forced.moves.size() == 1) {
+            lastStats.playouts = 0;
+            lastStats.winRate = (forced.kind == ThreatScanner::WIN || forced.kind == ThreatScanner::DOUBLE) ? 65535 : 32768;
+            lastStats.candidates = 1;
+            if (clock != nullptr) clock->consumed(secondsSince(start));
+            return forced.moves[0];
+        }
+        const std::vector<std::pair<int, int>>* region = forced.kind == ThreatScanner::REGION ? &forced.moves : nullptr;
+        const Replies* answers = vcs ? &replies : nullptr;
+        std::vector<CandidateStats> seeded;
+        if (positions != nullptr && pondered == nullptr && region == nullptr && seedFromDatabase(board, bluePath, seeded)) {
+            pondered = &seeded; // archive games stand in for trials, like pondered statistics
+        }
+        std::vector<CandidateStats> candidates =
+            clock != nullptr ? searchTimed(board, bluePath, pondered, region, answers, start)
+                             : analyze(board, bluePath, simulations, pondered, region, answers);
+        size_t best = bestCandidate(candidates);
+
+        long long playouts = 0;
+        for (const CandidateStats& candidate : candidates) {
+            playouts += candidate.trials;
+        }
+        lastStats.playouts = static_cast<std::uint32_t>(playouts);
+        lastStats.winRate = static_cast<std::uint16_t>(candidates[best].winRate() * 65535.0 + 0.5);
+        lastStats.candidates = static_cast<std::uint16_t>(candidates.size());
+        if (clock != nullptr) clock->consumed(secondsSince(start));
+        return candidates[best].move;
+    }
+
+    // Every legal move, warm-started from the position database when it knows the resulting positions
+    std::vector<CandidateStats> seededCandidates(Board board, BluePath bluePath) const {
+        std::vector<CandidateStats> candidates = listCandidates(board);
+        if (positions != nullptr) seedFromDatabase(board, bluePath, candidates);
+        return candidates;
+    }
+
+private:
+    // Candidate statistics from the position database: each move's resulting position, as seen from the opponent in
+    // archived games, counts as up to databaseTrials trials at the archive's win rate. False when nothing was found.
+    bool seedFromDatabase(Board& board, BluePath bluePath, std::vector<CandidateStats>& candidates) const {
+        candidates = listCandidates(board);
+        bool found = false;
+        const size_t mark = board.journalMark();
+        for (CandidateStats& candidate : candidates) {
+            board.placeStone(candidate.move.first, candidate.move.second, player);
+            PositionDatabase::Stats stats;
+            if (positions->lookup(board, bluePath, opponent, stats) && stats.visits > 0) {
+                const int trials = static_cast<int>(std::min<std::uint32_t>(stats.visits, databaseTrials));
+                candidate.trials = trials;
+                candidate.wins = static_cast<int>(std::lround(trials * double(stats.visits - stats.wins) / stats.visits));
+                found = true;
+            }
+            board.rollback(mark);
+        }
+        return found;
+    }
+
+    // Legal moves (or just the region's) with the warm statistics when they belong to the same list
+    static std::vector<CandidateStats> startingCandidates(const Board& board, const std::vector<CandidateStats>* warm,
+                                                          const std::vector<std::pair<int, int>>* region) {
+        std::vector<CandidateStats> candidates = listCandidates(board);
+        if (region != nullptr) {
+            candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                            [&](const CandidateStats& candidate) {
+                                                return std::find(region->begin(), region->end(), candidate.move) ==
+                                                       region->end();
+                                            }),
+                             candidates.end());
+        } else if (warm != nullptr && warm->size() == candidates.size()) {
+            candidates = *warm;
+        }
+        return candidates;
+    }
+
+    // Updates both players' virtual connections to the position, then: a semi VC of ours between the edges is a
+    // winning move; otherwise our reply must lie inside every carrier of the opponent's edge-to-edge connections,
+    // which narrows the threat scanner's region. Two-cell carriers on both sides become playout answers.
+    void applyVcs(const Board& board, BluePath bluePath, ThreatScanner::Result& forced, Replies& replies) {
+        if (ownVcs == nullptr || ownVcs->getSize() != board.getSize() || vcPath != bluePath) {
+            ownVcs = std::make_shared<VirtualConnections>(board, player, bluePath);
+            opponentVcs = std::make_shared<VirtualConnections>(board, opponent, bluePath);
+            vcPath = bluePath;
+        } else {
+            ownVcs->sync(board);
+            opponentVcs->sync(board);
+        }
+        ownVcs->bridgeReplies(replies[player == Player::BLUE ? 0 : 1]);
+        opponentVcs->bridgeReplies(replies[opponent == Player::BLUE ? 0 : 1]);
+
+        const int size = board.getSize();
+        int key = ownVcs->winningMove();
+        if (key >= 0) {
+            forced = {ThreatScanner::WIN, {{key / size, key % size}}};
+            return;
+        }
+        VirtualConnections::Carrier carrier;
+        if (!opponentVcs->mustPlay(carrier)) return;
+        std::vector<std::pair<int, int>> region;
+        for (int cell = 0; cell < size * size; ++cell) {
+            std::pair<int, int> move{cell / size, cell % size};
+            if (!carrier.test(cell)) continue;
+            if (forced.kind == ThreatScanner::REGION &&
+                std::find(forced.moves.begin(), forced.moves.end(), move) == forced.moves.end()) {
+                continue;
+            }
+            region.push_back(move);
+        }
+        // Nothing left means every reply loses against perfect play; keep searching the scanner's moves then
+        if (!region.empty()) forced = {ThreatScanner::REGION, region};
+    }
+
+    static double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Rounds of `roundTrials` per candidate until the clock's budget for this move says stop; the hard limit is also
+    // checked after every candidate, so a slow round cannot overrun it
+    std::vector<CandidateStats> searchTimed(const Board& board, BluePath bluePath, const std::vector<CandidateStats>* warm,
+                                            const std::vector<std::pair<int, int>>* region, const Replies* replies,
+                                            std::chrono::steady_clock::time_point start) const {
+        std::vector<CandidateStats> candidates = startingCandidates(board, warm, region);
+        if (candidates.size() <= 1) return candidates; // forced move
+
+        // The game's length follows the empty cells, not the must-play region the candidates may be cut down to
+        const int size = board.getSize();
+        const TimeManager::Budget budget = clock->plan(size * size - board.stonesPlaced());
+        for (int trials = roundTrials;; trials += roundTrials) {
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                if (candidates[i].trials < trials) {
+                    addTrials(board, bluePath, i, candidates[i], trials - candidates[i].trials, replies);
+                }
+                if (secondsSince(start) >= budget.limit) return candidates;
+            }
+            if (TimeManager::shouldStop(secondsSince(start), budget, confidence(candidates, bestCandidate(candidates)))) {
+                return candidates;
+            }
+        }
+    }
+
+    // Plays the game out on `board` with placeStone; the caller rolls the stones back. With `replies`, a move into a
+    // two-cell carrier is answered at once in the other cell, so settled bridges stay connected. With priors, the
+    // heaviest empty neighbour of the last move is played instead of a random cell when it weighs at least
+    // priorReply.
+    bool simulateRandomGame(Board& board, BluePath bluePath, Xoroshiro128Plus& rng, const Replies* replies) const {
+        if (playouts == Playouts::HEURISTIC) {
+            return simulateHeuristicGame(board, bluePath, rng);
+        }
+        thread_local std::vector<std::pair<int, int>> moves; // keeps its capacity from playout to playout
+        moves.clear();
+        int size = board.getSize();
+
+        for (int i = 0; i < size; ++i) {
+            for (int j = 0; j < size; ++j) {
+                if (board.isValidMove(i, j)) {
+                    moves.emplace_back(i, j);
+                }
+            }
+        }
+
+        Player currentSimPlayer = opponent;
+        shuffleWith(moves, rng);
+
+        size_t next = 0;
+        int answer = -1;
+        while (true) {
+            std::pair<int, int> move;
+            if (answer >= 0) {
+                move = {answer / size, answer % size};
+            } else {
+                while (next < moves.size() && !board.isValidMove(moves[next].first, moves[next].second)) ++next;
+                if (next == moves.size()) return false;
+                move = moves[next++];
+            }
+            board.placeStone(move.first, move.second, currentSimPlayer);
+            if (board.hasWinner(currentSimPlayer, bluePath)) {
+                return currentSimPlayer == player;
+            }
+            currentSimPlayer = (currentSimPlayer == Player::BLUE) ? Player::RED : Player::BLUE;
+            answer = -1;
+            if (replies != nullptr) {
+                int reply = (*replies)[currentSimPlayer == Player::BLUE ? 0 : 1][move.first * size + move.second];
+                if (reply >= 0 && board.isValidMove(reply / size, reply % size)) answer = reply;
+            }
+            if (answer < 0 && priors != nullptr) {
+                answer = priorAnswer(board, bluePath, currentSimPlayer, move);
+            }
+        }
+    }
+
+    // The heaviest empty neighbour of `last` for `mover`, or -1 when none reaches priorReply
+    int priorAnswer(const Board& board, BluePath bluePath, Player mover, std::pair<int, int> last) const {
+        const int size = board.getSize();
+        int best = -1;
+        float bestWeight = priorReply;
+        for (const auto& offset : hexDirections) {
+            const int x = last.first + offset[0], y = last.second + offset[1];
+            if (!board.isValidMove(x, y)) continue;
+            const float weight = priors->prior(board, bluePath, mover, x, y);
+            if (weight >= bestWeight) {
+                bestWeight = weight;
+                best = x * size + y;
+            }
+        }
+        return best;
+    }
+
+    // Antithetic pair from one shuffle of the empty cells: the cells are dealt alternately starting with the
+    // opponent, the filled board is scored, then every colour is swapped and it is scored again. A filled board has
+    // exactly one winner, so the two results are strongly anti-correlated. With an odd number of cells the last one
+    // keeps its colour, which leaves the opponent its extra stone and makes both halves unbiased playouts.
+    void scorePairedFill(Board& board, BluePath bluePath, Xoroshiro128Plus& rng, bool wins[2]) const {
+        thread_local std::vector<std::pair<int, int>> moves; // keeps its capacity from fill to fill
+        listMoves(board, moves);
+        shuffleWith(moves, rng);
+        const size_t mark = board.journalMark();
+        for (size_t i = 0; i < moves.size(); ++i) {
+            board.placeStone(moves[i].first, moves[i].second, i % 2 == 0 ? opponent : player);
+        }
+        wins[0] = board.hasWinner(player, bluePath);
+        board.rollback(mark);
+        const size_t swapped = moves.size() - moves.size() % 2;
+        for (size_t i = 0; i < moves.size(); ++i) {
+            board.placeStone(moves[i].first, moves[i].second, (i % 2 == 0) == (i < swapped) ? player : opponent);
+        }
+        wins[1] = board.hasWinner(player, bluePath);
+    }
+
+    // Playout where each move comes from the heuristic bot or, with the remaining probability, the shuffled order;
+    // the bot's union-find also makes the win check constant time
+    bool simulateHeuristicGame(const Board& board, BluePath bluePath, Xoroshiro128Plus& rng) const {
+        HeuristicPlayer bot(board, bluePath);
+        std::vector<std::pair<int, int>> moves;
+        listMoves(board, moves);
+        shuffleWith(moves, rng);
+
+        Player currentSimPlayer = opponent;
+        size_t next = 0;
+        while (true) {
+            std::pair<int, int> move;
+            if (static_cast<int>(rng.bounded(100)) < heuristicShare) {
+                move = bot.bestMove(currentSimPlayer);
+                if (move.first < 0) return false;
+            } else {
+                while (next < moves.size() && !bot.isEmpty(moves[next].first, moves[next].second)) ++next;
+                if (next == moves.size()) return false;
+                move = moves[next];
+            }
+            bot.play(move.first, move.second, currentSimPlayer);
+            if (bot.hasWon(currentSimPlayer)) {
+                return currentSimPlayer == player;
+            }
+            currentSimPlayer = (currentSimPlayer == Player::BLUE) ? Player::RED : Player::BLUE;
+        }
+    }
+
+    // Replaces the contents of `moves` with the empty cells in row-major order, keeping its capacity
+    static void listMoves(const Board& board, std::vector<std::pair<int, int>>& moves) {
+        moves.clear();
+        for (int i = 0; i < board.getSize(); ++i) {
+            for (int j = 0; j < board.getSize(); ++j) {
+                if (board.isValidMove(i, j)) moves.emplace_back(i, j);
+            }
+        }
+    }
+};
+// Win-rate variance of single versus antithetic paired trials. Along a seeded random game, one candidate per position
+// is estimated `repeats` times from `fills` random fills each (a fill is one trial, or two paired ones), and the spread
+// of the estimates is compared. The ratio is how many times fewer fills pairing needs for the same confidence.
+void benchVariance(int size, std::uint64_t seed) {
+    const int positions = 8, repeats = 100, fills = 64;
+    Board board(size);
+    std::vector<std::pair<int, int>> moves;
+    for (int x = 0; x < size; ++x) {
+        for (int y = 0; y < size; ++y) moves.emplace_back(x, y);
+    }
+    Xoroshiro128Plus rng(seed);
+    shuffleWith(moves, rng);
+
+    Player toMove = Player::BLUE;
+    double singleTotal = 0.0, pairedTotal = 0.0;
+    for (int position = 0; position < positions; ++position) {
+        for (int i = 0; i < 4; ++i) { // four more stones between positions
+            const std::pair<int, int> move = moves[4 * position + i];
+            board.makeMove(move.first, move.second, toMove);
+            toMove = toMove == Player::BLUE ? Player::RED : Player::BLUE;
+        }
+        const std::pair<int, int> candidate = moves[4 * positions + position];
+        double variance[2], mean[2], seconds[2];
+        for (int mode = 0; mode < 2; ++mode) {
+            double sum = 0.0, squares = 0.0;
+            auto start = std::chrono::steady_clock::now();
+            for (int repeat = 0; repeat < repeats; ++repeat) {
+                std::uint64_t state = seed + static_cast<std::uint64_t>(repeat);
+                AIPlayer engine(toMove, splitMix64(state));
+                engine.setPairedTrials(mode == 1);
+                AIPlayer::CandidateStats stats{candidate, 0, 0};
+                engine.addTrials(board, BluePath::LEFT_TO_RIGHT, 0, stats, mode == 1 ? 2 * fills : fills);
+                sum += stats.winRate();
+                squares += stats.winRate() * stats.winRate();
+            }
+            seconds[mode] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            mean[mode] = sum / repeats;
+            variance[mode] = (squares - sum * sum / repeats) / (repeats - 1);
+        }
+        singleTotal += variance[0];
+        pairedTotal += variance[1];
+        std::cout << "position " << position << ": win rate " << std::fixed << std::setprecision(3) << mean[0] << " / "
+                  << mean[1] << ", variance per fill " << std::setprecision(4) << variance[0] * fills << " single, "
+                  << variance[1] * fills << " paired (ratio " << std::setprecision(2)
+                  << variance[0] / std::max(variance[1], 1e-12) << "), " << std::setprecision(1)
+                  << 1e6 * seconds[0] / (repeats * fills) << " / " << 1e6 * seconds[1] / (repeats * fills)
+                  << " us per fill" << std::defaultfloat << std::endl;
+    }
+    std::cout << "Overall variance ratio " << std::fixed << std::setprecision(2)
+              << singleTotal / std::max(pairedTotal, 1e-12) << std::defaultfloat << std::endl;
+}
+
+// Exhaustive game inside one carrier: the player and the opponent take turns on its empty cells, the opponent first,
+// until it is full. A full VC is sound when the player joins its two nodes however the opponent plays; a semi VC is
+// checked the same way with the player's stone already on the key. Endpoints that are empty cells count as the
+// player's. Meant for the small carriers of the self-check, since the cost grows as 3^cells.
+class CarrierGame {
+public:
+    CarrierGame(const Board& board, Player player, BluePath bluePath)
+        : size(board.getSize()), cells(size * size), player(player), bluePath(bluePath), stones(cells) {
+        for (int cell = 0; cell < cells; ++cell) stones[cell] = board.getPlayerAt(cell / size, cell % size);
+    }
+
+    bool holds(int a, int b, const VirtualConnections::Carrier& carrier, int key) {
+        std::vector<Player> saved = stones;
+        free.clear();
+        memo.clear();
+        for (int cell = 0; cell < cells; ++cell) {
+            if (carrier.test(cell) && cell != key) free.push_back(cell);
+        }
+        if (key >= 0) stones[key] = player;
+        if (a < cells) stones[a] = player;
+        if (b < cells) stones[b] = player;
+        bool result = play(a, b, false);
+        stones = saved;
+        return result;
+    }
+
+private:
+    int size;
+    int cells;
+    Player player;
+    BluePath bluePath;
+    std::vector<Player> stones;
+    std::vector<int> free;              // the carrier cells still to play
+    std::map<std::uint64_t, bool> memo; // carrier state in base 3, times two for the side to move
+    std::vector<int> stack;
+
+    // The player wins from here with `ownTurn` telling who moves
+    bool play(int a, int b, bool ownTurn) {
+        std::uint64_t state = 0;
+        bool full = true;
+        for (int cell : free) {
+            state = 3 * state + static_cast<std::uint64_t>(stones[cell]);
+            full = full && stones[cell] != Player::BLANK;
+        }
+        if (full) return joined(a, b);
+        state = 2 * state + (ownTurn ? 1 : 0);
+        auto known = memo.find(state);
+        if (known != memo.end()) return known->second;
+
+        const Player mover = ownTurn ? player : (player == Player::BLUE ? Player::RED : Player::BLUE);
+        bool result = !ownTurn;
+        for (int cell : free) {
+            if (stones[cell] != Player::BLANK) continue;
+            stones[cell] = mover;
+            const bool wins = play(a, b, !ownTurn);
+            stones[cell] = Player::BLANK;
+            if (wins == ownTurn) {
+                result = wins;
+                break;
+            }
+        }
+        memo[state] = result;
+        return result;
+    }
+
+    int edgeLine(int cell) const {
+        const bool acrossColumns = (player == Player::BLUE) == (bluePath == BluePath::LEFT_TO_RIGHT);
+        return acrossColumns ? cell % size : cell / size;
+    }
+
+    // Node `node` is the cell itself, or one of the player's edges
+    bool touches(int cell, int node) const {
+        if (node < cells) return cell == node;
+        return edgeLine(cell) == (node == cells ? 0 : size - 1);
+    }
+
+    bool joined(int a, int b) {
+        std::vector<char> seen(cells, 0);
+        stack.clear();
+        for (int cell = 0; cell < cells; ++cell) {
+            if (stones[cell] == player && touches(cell, a)) {
+                seen[cell] = 1;
+                stack.push_back(cell);
+            }
+        }
+        while (!stack.empty()) {
+            const int cell = stack.back();
+            stack.pop_back();
+            if (touches(cell, b)) return true;
+            for (const auto& direction : hexDirections) {
+                const int nx = cell / size + direction[0], ny = cell % size + direction[1];
+                if (nx < 0 || nx >= size || ny < 0 || ny >= size) continue;
+                const int next = nx * size + ny;
+                if (!seen[next] && stones[next] == player) {
+                    seen[next] = 1;
+                    stack.push_back(next);
+                }
+            }
+        }
+        return false;
+    }
+};
+
+// Soundness self-check of the H-search. Along seeded random games every VC whose carrier has at most `maxCarrier`
+// cells is played out exhaustively with CarrierGame after each move; returns false when any of them is unsound. Wins
+// found by the incremental and a from-scratch build are compared too, but only reported: the capped lists keep the
+// search incomplete, so the order the stones came in can change what it finds.
+bool checkVirtualConnections(int size, int games, std::uint64_t seed) {
+    const int cells = size * size, maxCarrier = 10;
+    Xoroshiro128Plus rng(seed);
+    long long checked = 0, unsound = 0, mismatched = 0;
+    for (int game = 0; game < games; ++game) {
+        const BluePath bluePath = game % 2 ? BluePath::LEFT_TO_RIGHT : BluePath::TOP_TO_BOTTOM;
+        const Player player = (game / 2) % 2 ? Player::BLUE : Player::RED;
+        Board board(size);
+        VirtualConnections connections(board, player, bluePath);
+        std::vector<int> order(cells);
+        for (int cell = 0; cell < cells; ++cell) order[cell] = cell;
+        shuffleWith(order, rng);
+
+        Player toMove = Player::BLUE;
+        for (int move = 0; move < cells * 2 / 3; ++move) {
+            board.makeMove(order[move] / size, order[move] % size, toMove);
+            toMove = toMove == Player::BLUE ? Player::RED : Player::BLUE;
+            connections.sync(board);
+            if (connections.connected()) break;
+
+            VirtualConnections fresh(board, player, bluePath);
+            if (fresh.winning() != connections.winning()
+                || (fresh.winningMove() >= 0) != (connections.winningMove() >= 0)) {
+                ++mismatched;
+            }
+            CarrierGame carrierGame(board, player, bluePath);
+            connections.forEachConnection([&](int a, int b, const VirtualConnections::Carrier& carrier, int key) {
+                if (static_cast<int>(carrier.count()) > maxCarrier) return;
+                ++checked;
+                if (carrierGame.holds(a, b, carrier, key)) return;
+                if (++unsound <= 5) {
+                    std::cout << "unsound " << (key < 0 ? "full" : "semi") << " VC between nodes " << a << " and "
+                              << b << " (" << carrier.count() << " cells) in game " << game << std::endl;
+                }
+            });
+        }
+    }
+    std::cout << size << "x" << size << ": checked " << checked << " VCs over " << games << " games, " << unsound
+              << " unsound; " << mismatched << " positions where the incremental and fresh wins differ" << std::endl;
+    return unsound == 0;
+}
+
+// Evaluates every opening of a size and writes the first-move table. Boards the small-board solver can finish are
+// solved exactly; larger ones run a two-ply search: every RED reply to the opening gets `trials` Monte Carlo trials and
+// the opening is worth one minus RED's best reply. The 180 degree rotation of an opening has the same value, so only
+// half the cells are searched, spread over `threads` workers.
+bool buildFirstMoveTable(int size, int trials, int threads, std::uint64_t seed, const std::string& path) {
+    const int cells = size * size;
+    const bool exact = size <= 4; // the solver needs minutes per opening from 5x5 on
+    std::vector<float> values(cells, 0.0f);
+    if (exact) threads = 1; // one solver cache is large enough
+    std::atomic<int> nextCell(0);
+    std::mutex reportMutex;
+    auto worker = [&]() {
+        SmallBoardSolver* solver = exact ? new SmallBoardSolver(size) : nullptr;
+        for (int cell = nextCell++; cell < cells; cell = nextCell++) {
+            if (cells - 1 - cell < cell) continue; // the rotated twin is searched instead
+            double value;
+            if (exact) {
+                int best;
+                value = solver->solve(SmallBoardSolver::cellBit(cell), 0, best) ? 0.0 : 1.0;
+            } else {
+                Board board(size);
+                board.makeMove(cell / size, cell % size, Player::BLUE);
+                AIPlayer red(Player::RED, seed + cell);
+                std::vector<AIPlayer::CandidateStats> replies = red.analyze(board, BluePath::LEFT_TO_RIGHT, trials);
+                value = 1.0 - replies[AIPlayer::bestCandidate(replies)].winRate();
+            }
+            values[cell] = values[cells - 1 - cell] = static_cast<float>(value);
+            std::lock_guard<std::mutex> lock(reportMutex);
+            std::cout << "opening " << cell / size << " " << cell % size << ": " << std::fixed << std::setprecision(3)
+                      << value << std::defaultfloat << std::endl;
+        }
+        delete solver;
+    };
+    std::vector<std::thread> helpers;
+    for (int t = 1; t < threads; ++t) {
+        helpers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+
+    FirstMoveTableHeader header = FirstMoveTableHeader();
+    std::memcpy(header.magic, "HEXO", 4);
+    header.version = 1;
+    header.boardSize = static_cast<std::uint8_t>(size);
+    header.exact = exact ? 1 : 0;
+    header.trials = exact ? 0 : static_cast<std::uint32_t>(trials);
+    header.seed = seed;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(cells * sizeof(float)));
+    return static_cast<bool>(out);
+}
+
+//Pondering: keeps searching on the opponent's time while the human is thinking
+// The most likely replies are predicted with a cheap search from the opponent's side, then the AI's own trials for
+// the position after each of them run round-robin. The trials are the exact ones getBestMove would run, so a ponder
+// hit only saves time and never changes the chosen move.
+class Ponderer {
+private:
+    struct ReplyLine {
+        std::pair<int, int> reply;
+        Board board; // position after the reply
+        std::vector<AIPlayer::CandidateStats> candidates;
+    };
+
+    const AIPlayer& engine;
+    std::thread worker;
+    std::atomic<bool> stopRequested;
+    Board root;
+    BluePath bluePath;
+    std::vector<ReplyLine> lines; // owned by the worker while it runs
+
+    static const int maxReplies = 6;       // predicted replies searched in parallel
+    static const int predictionTrials = 16; // trials per reply for the prediction search
+    static const int chunk = 8;            // trials between checks of the stop flag
+
+public:
+    explicit Ponderer(const AIPlayer& engine) : engine(engine), stopRequested(false), root(1), bluePath(BluePath::LEFT_TO_RIGHT) {}
+
+    ~Ponderer() {
+        cancel();
+    }
+
+    Ponderer(const Ponderer&) = delete;
+    Ponderer& operator=(const Ponderer&) = delete;
+
+    // Starts pondering on a position where the opponent is to move
+    void start(const Board& board, BluePath path) {
+        cancel();
+        root = board;
+        bluePath = path;
+        lines.clear();
+        stopRequested = false;
+        worker = std::thread(&Ponderer::run, this);
+    }
+
+    // Stops the search; returns true and the statistics gathered so far when the reply was one of the pondered lines
+    bool finish(std::pair<int, int> reply, std::vector<AIPlayer::CandidateStats>& stats) {
+        cancel();
+        for (ReplyLine& line : lines) {
+            if (line.reply == reply) {
+                stats = std::move(line.candidates);
+                lines.clear();
+                return true;
+            }
+        }
+        lines.clear();
+        return false;
+    }
+
+    void cancel() {
+        stopRequested = true;
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+private:
+    void run() {
+        Player opponent = engine.getPlayer() == Player::BLUE ? Player::RED : Player::BLUE;
+        AIPlayer model(opponent, engine.getSeed() ^ 0x9E3779B97F4A7C15ULL);
+        std::vector<AIPlayer::CandidateStats> replies = AIPlayer::listCandidates(root);
+        for (int done = 0; done < predictionTrials; done += chunk) {
+            for (size_t i = 0; i < replies.size(); ++i) {
+                if (stopRequested) return;
+                model.addTrials(root, bluePath, i, replies[i], chunk);
+            }
+        }
+        std::stable_sort(replies.begin(), replies.end(),
+                         [](const AIPlayer::CandidateStats& a, const AIPlayer::CandidateStats& b) {
+                             return a.winRate() > b.winRate();
+                         });
+
+        for (size_t i = 0; i < replies.size() && i < static_cast<size_t>(maxReplies); ++i) {
+            ReplyLine line{replies[i].move, root, {}};
+            line.board.makeMove(line.reply.first, line.reply.second, opponent);
+            line.candidates = AIPlayer::listCandidates(line.board);
+            lines.push_back(std::move(line));
+        }
+
+        bool progress = true;
+        while (progress) {
+            progress = false;
+            for (ReplyLine& line : lines) {
+                for (size_t i = 0; i < line.candidates.size(); ++i) {
+                    int remaining = AIPlayer::simulations - line.candidates[i].trials;
+                    if (remaining <= 0) continue;
+                    if (stopRequested) return;
+                    engine.addTrials(line.board, bluePath, i, line.candidates[i], std::min(chunk, remaining));
+                    progress = true;
+                }
+            }
+        }
+    }
+};
+
+//AI Agent which uses MCS algorithm for Efficient Computation of Trials
+class AIGame : public Game {
+private:
+    AIPlayer aiPlayer;
+    Ponderer ponderer;
+    bool pondering;
+    TimeManager clock;
+    bool timed;
+
+public:
+    AIGame(int size, Player userPlayer, std::uint64_t seed = RandomStreams::clockSeed())
+        : Game(size), aiPlayer(userPlayer == Player::BLUE ? Player::RED : Player::BLUE, seed), ponderer(aiPlayer),
+          pondering(false), clock(), timed(false) {
+        currentPlayer = Player::BLUE;
+        std::cout << "AI seed: " << aiPlayer.getSeed() << " (rerun with --seed " << aiPlayer.getSeed()
+                  << " to replay the AI's choices)" << std::endl;
+        if (userPlayer == Player::RED) {
+            askBluePath();
+        } else {
+            askUserPath();
+        }
+    }
+
+    void setTable(const PerfectPlayTable* table) {
+        aiPlayer.setTable(table);
+    }
+
+    // Search on the human's time while waiting for their move
+    void setPondering(bool enabled) {
+        pondering = enabled;
+    }
+
+    // Plays the whole game on a clock of `totalSeconds` plus `incrementSeconds` per move instead of fixed trials
+    void setClock(double totalSeconds, double incrementSeconds) {
+        clock = TimeManager(totalSeconds, incrementSeconds);
+        timed = true;
+        aiPlayer.setClock(&clock);
+    }
+
+    void setLevel(AIPlayer::Level level) {
+        aiPlayer.setLevel(level);
+    }
+
+    void setPlayouts(AIPlayer::Playouts playouts) {
+        aiPlayer.setPlayouts(playouts);
+    }
+
+    void setVirtualConnections(bool enabled) {
+        aiPlayer.setVirtualConnections(enabled);
+    }
+
+    void setPairedTrials(bool enabled) {
+        aiPlayer.setPairedTrials(enabled);
+    }
+
+    void setPriors(const PatternPriors* priors) {
+        aiPlayer.setPriors(priors);
+    }
+
+    void setPositionDatabase(const PositionDatabase* database) {
+        aiPlayer.setPositionDatabase(database);
+    }
+
+    //Game loop
+    void play() override {
+        int moveCount = 0;
+        Player userPlayer = aiPlayer.getPlayer() == Player::BLUE ? Player::RED : Player::BLUE;
+        startRecord(aiPlayer.getPlayer() == Player::BLUE ? 1 : 2, AIPlayer::simulations, aiPlayer.getSeed());
+        std::vector<AIPlayer::CandidateStats> pondered;
+        bool ponderHit = false;
+        std::pair<int, int> prepared(-1, -1); // engine reply already searched while deciding on a swap
+
+        while (true) {
+            renderer.draw(board);
+            if (currentPlayer == userPlayer) {
+                int x, y;
+                bool validMove = false;
+                if (pondering) {
+                    ponderer.start(board, bluePath);
+                }
+
+                while (!validMove) {
+                    std::cout << "Player " << (currentPlayer == Player::BLUE ? "BLUE" : "RED")
+                              << ", enter your move (x y): ";
+                    std::cin >> x >> y;
+
+                    if (std::cin.fail()) {
+                        std::cin.clear();
+                        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                        std::cerr << "Invalid input. Please enter numeric coordinates." << std::endl;
+                        continue;
+                    }
+
+                    if (board.isValidMove(x, y)) {
                         board.makeMove(x, y, currentPlayer);
+                        recordMove(x, y);
                         validMove = true;
                         moveCount++;
+                        if (pondering) {
+                            ponderHit = ponderer.finish({x, y}, pondered);
+                            reportPonder(ponderHit, pondered);
+                        }
 
                         if (board.hasWinner(currentPlayer, bluePath)) {
-                            board.display();
+                            finishRecord(currentPlayer);
+                            renderer.draw(board);
                             std::cout << "Player " << (currentPlayer == Player::BLUE ? "BLUE" : "RED")
                                       << " wins!" << std::endl;
                             return;
                         }
 
-                        currentPlayer = (currentPlayer == Player::BLUE) ? Player::RED : Player::BLUE;
-                    } else {
-                        std::cerr << "Invalid move. The coordinate is preoccupied or out of bounds. Try again."
-                                  << std::endl;
-                    }
-                }
+                        currentPlayer = (currentPlayer == Player::BLUE) ? Player::RED : Player::BLUE;
+                        if (swapRule && moveCount == 1 && engineSwaps(x, y, prepared)) {
+                            swapOpening(x, y);
+                            ponderHit = false;
+                        }
+                    } else {
+                        std::cerr << "Invalid move. The coordinate is preoccupied or out of bounds. Try again."
+                                  << std::endl;
+                    }
+                }
+            } else {
+                std::pair<int, int> bestMove;
+                MoveStats stats;
+                if (prepared.first >= 0) {
+                    bestMove = prepared; // the swap decision already searched this position
+                    stats = aiPlayer.getLastStats();
+                    prepared = {-1, -1};
+                } else if (swapRule && moveCount == 0 && openingTable() != nullptr) {
+                    bestMove = openingTable()->swapSafeOpening(bluePath);
+                    double value = openingTable()->value(bestMove.first, bestMove.second, bluePath);
+                    stats = {0, static_cast<std::uint16_t>(value * 65535.0 + 0.5), 1};
+                } else {
+                    bestMove = aiPlayer.getBestMove(board, bluePath, ponderHit ? &pondered : nullptr);
+                    stats = aiPlayer.getLastStats();
+                }
+                ponderHit = false;
+                board.makeMove(bestMove.first, bestMove.second, currentPlayer);
+                recordMove(bestMove.first, bestMove.second, &stats);
+                moveCount++;
+                std::cout << "AI Player " << (currentPlayer == Player::BLUE ? "BLUE" : "RED")
+                          << " makes move (" << bestMove.first << ", " << bestMove.second << ")" << std::endl;
+                if (timed) {
+                    std::cout << "AI clock: " << std::fixed << std::setprecision(1) << clock.getRemaining()
+                              << " s left after " << stats.playouts << " playouts" << std::defaultfloat << std::endl;
+                }
+
+                if (board.hasWinner(currentPlayer, bluePath)) {
+                    finishRecord(currentPlayer);
+                    renderer.draw(board);
+                    std::cout << "Player " << (currentPlayer == Player::BLUE ? "BLUE" : "RED")
+                              << " wins!" << std::endl;
+                    return;
+                }
+
+                currentPlayer = (currentPlayer == Player::BLUE) ? Player::RED : Player::BLUE;
+                if (swapRule && moveCount == 1 && askSwap()) {
+                    swapOpening(bestMove.first, bestMove.second);
+                }
+            }
+
+            if (checkDraw(moveCount)) {
+                finishRecord(Player::BLANK);
+                std::cout << "Game over! It's a draw!" << std::endl;
+                break;
+            }
+        }
+    }
+
+private:
+    // Whether the engine (as RED) should take over the human's opening at (x, y). With a table this is one lookup;
+    // without one, RED's replies are searched and the swap is taken when none of them reaches an even game, and
+    // otherwise the searched reply is kept in `reply` so it is not searched twice.
+    bool engineSwaps(int x, int y, std::pair<int, int>& reply) {
+        if (const FirstMoveTable* table = openingTable()) {
+            double value = table->value(x, y, bluePath);
+            std::cout << "Opening value for BLUE: " << std::fixed << std::setprecision(3) << value << std::defaultfloat
+                      << std::endl;
+            return value > 0.5;
+        }
+        std::pair<int, int> move = aiPlayer.getBestMove(board, bluePath);
+        if (aiPlayer.getLastStats().winRate < 32768) return true;
+        reply = move;
+        return false;
+    }
+
+    static void reportPonder(bool hit, const std::vector<AIPlayer::CandidateStats>& pondered) {
+        if (!hit) {
+            std::cout << "Ponder miss: reply was not among the predicted moves" << std::endl;
+            return;
+        }
+        long long done = 0;
+        for (const AIPlayer::CandidateStats& candidate : pondered) {
+            done += candidate.trials;
+        }
+        std::cout << "Ponder hit: " << done << " of " << pondered.size() * static_cast<long long>(AIPlayer::simulations)
+                  << " trials already done" << std::endl;
+    }
+
+    void askUserPath() {
+        int choice;
+        std::cout << "Player RED, choose your path:\n";
+        std::cout << "1. Left to Right\n";
+        std::cout << "2. Top to Bottom\n";
+        std::cout << "Enter your choice (1 or 2): ";
+        std::cin >> choice;
+
+        if (choice == 1) {
+            bluePath = BluePath::TOP_TO_BOTTOM;
+        } else if (choice == 2) {
+            bluePath = BluePath::LEFT_TO_RIGHT;
+        } else {
+            std::cerr << "Invalid choice. Defaulting to Top to Bottom." << std::endl;
+            bluePath = BluePath::TOP_TO_BOTTOM;
+        }
+    }
+};
+
+//Large Boards: tiled storage and local move generation for boards far beyond 19x19
+// Cells live in 8x8 tiles, one 64-bit mask per colour, created the first time a stone lands in them, so memory follows
+// the stones rather than the area. Chains are a union-find over stone cells; each root keeps the player's edges it
+// touches and its extent along the player's direction (with the cells at both ends, its tips). A move only looks at
+// its six neighbours, so keeping chains and detecting a win cost constant time per move. Each tile also keeps a
+// summary of its stones per colour and how many of them touch an enemy stone.
+class TiledBoard {
+public:
+    struct Chain {
+        int edges;         // bit 0: player's first edge, bit 1: last edge
+        int low, high;     // extent along the player's direction
+        long long lowTip, highTip; // cells at both ends of that extent
+        int stones;
+    };
+
+    struct Tile {
+        std::uint64_t stones[2]; // BLUE, RED; bit (x % 8) * 8 + y % 8
+        int count[2];
+        int contacts;            // stones of this tile touching an opposing stone
+    };
+
+    static const int tileSide = 8;
+
+private:
+    long long size;
+    long long tilesPerSide;
+    BluePath bluePath;
+    std::unordered_map<long long, Tile> tiles;
+    std::unordered_map<long long, long long> parent; // stone cell -> parent cell
+    std::unordered_map<long long, Chain> chains;     // root cell -> chain
+    std::vector<long long> history;
+    Player winner;
+
+public:
+    TiledBoard(long long size, BluePath bluePath)
+        : size(size), tilesPerSide((size + tileSide - 1) / tileSide), bluePath(bluePath), winner(Player::BLANK) {}
+
+    long long getSize() const {
+        return size;
+    }
+
+    Player getWinner() const {
+        return winner;
+    }
+
+    const std::vector<long long>& getHistory() const {
+        return history;
+    }
+
+    long long cell(long long x, long long y) const {
+        return x * size + y;
+    }
+
+    // Top-left cell of the tile with the given key
+    std::pair<long long, long long> tileOrigin(long long key) const {
+        return {key / tilesPerSide * tileSide, key % tilesPerSide * tileSide};
+    }
+
+    bool inside(long long x, long long y) const {
+        return x >= 0 && x < size && y >= 0 && y < size;
+    }
+
+    Player at(long long x, long long y) const {
+        auto found = tiles.find(tileOf(x, y));
+        if (found == tiles.end()) return Player::BLANK;
+        const std::uint64_t bit = std::uint64_t(1) << bitOf(x, y);
+        if (found->second.stones[0] & bit) return Player::BLUE;
+        if (found->second.stones[1] & bit) return Player::RED;
+        return Player::BLANK;
+    }
+
+    bool isValidMove(long long x, long long y) const {
+        return inside(x, y) && at(x, y) == Player::BLANK;
+    }
+
+    // Coordinate along the direction the player has to cross
+    long long axis(Player player, long long x, long long y) const {
+        const bool acrossColumns = (player == Player::BLUE) == (bluePath == BluePath::LEFT_TO_RIGHT);
+        return acrossColumns ? y : x;
+    }
+
+    void makeMove(long long x, long long y, Player player) {
+        const int p = player == Player::BLUE ? 0 : 1;
+        const long long here = cell(x, y);
+        Tile& tile = tiles[tileOf(x, y)];
+        tile.stones[p] |= std::uint64_t(1) << bitOf(x, y);
+        tile.count[p]++;
+        history.push_back(here);
+
+        const long long line = axis(player, x, y);
+        parent[here] = here;
+        chains[here] = Chain{(line == 0 ? 1 : 0) | (line == size - 1 ? 2 : 0), static_cast<int>(line),
+                             static_cast<int>(line), here, here, 1};
+        bool touchesEnemy = false;
+        forNeighbours(x, y, [&](long long nx, long long ny) {
+            Player stone = at(nx, ny);
+            if (stone == player) {
+                unite(here, cell(nx, ny));
+            } else if (stone != Player::BLANK) {
+                if (!touchesEnemy) tile.contacts++;
+                touchesEnemy = true;
+                // The enemy neighbour is in contact from now on, unless another of our stones already touched it
+                bool already = false;
+                forNeighbours(nx, ny, [&](long long ox, long long oy) {
+                    if ((ox != x || oy != y) && at(ox, oy) == player) already = true;
+                });
+                if (!already) tiles[tileOf(nx, ny)].contacts++;
+            }
+        });
+        const Chain& merged = chains[find(here)];
+        if (merged.edges == 3) winner = player;
+    }
+
+    long long find(long long stone) {
+        long long root = stone;
+        while (parent[root] != root) root = parent[root];
+        while (parent[stone] != root) {
+            long long next = parent[stone];
+            parent[stone] = root;
+            stone = next;
+        }
+        return root;
+    }
+
+    const Chain& chainOf(long long stone) {
+        return chains[find(stone)];
+    }
+
+    const std::unordered_map<long long, Chain>& allChains() const {
+        return chains;
+    }
+
+    const std::unordered_map<long long, Tile>& allTiles() const {
+        return tiles;
+    }
+
+    // Approximate heap use: tiles, union-find entries and chain records, with hash-node overhead
+    std::size_t memoryBytes() const {
+        const std::size_t node = 2 * sizeof(void*);
+        return tiles.size() * (sizeof(Tile) + sizeof(long long) + node) +
+               parent.size() * (2 * sizeof(long long) + node) + chains.size() * (sizeof(Chain) + sizeof(long long) + node) +
+               history.capacity() * sizeof(long long);
+    }
+
+    // Rows and columns [x0, x0 + span) x [y0, y0 + span) in the usual slanted layout, with coordinates on the border
+    std::string window(long long x0, long long y0, int span) const {
+        x0 = std::max(0LL, std::min(x0, size - span));
+        y0 = std::max(0LL, std::min(y0, size - span));
+        const long long rows = std::min<long long>(span, size), cols = std::min<long long>(span, size);
+        std::ostringstream out;
+        out << "rows " << x0 << "-" << x0 + rows - 1 << ", columns " << y0 << "-" << y0 + cols - 1 << "\n";
+        for (long long x = x0; x < x0 + rows; ++x) {
+            out << std::string(static_cast<size_t>(x - x0), ' ') << std::setw(6) << x << "  ";
+            for (long long y = y0; y < y0 + cols; ++y) {
+                out << Board::symbol(at(x, y)) << ' ';
+            }
+            out << "\n";
+        }
+        return out.str();
+    }
+
+    template <typename Visit>
+    void forNeighbours(long long x, long long y, Visit visit) const {
+        for (const auto& direction : hexDirections) {
+            long long nx = x + direction[0], ny = y + direction[1];
+            if (inside(nx, ny)) visit(nx, ny);
+        }
+    }
+
+private:
+    long long tileOf(long long x, long long y) const {
+        return (x / tileSide) * tilesPerSide + y / tileSide;
+    }
+
+    static int bitOf(long long x, long long y) {
+        return static_cast<int>((x % tileSide) * tileSide + y % tileSide);
+    }
+
+    // Keeps the larger chain's root, so paths stay short
+    void unite(long long a, long long b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) return;
+        if (chains[a].stones < chains[b].stones) {
+            std::swap(a, b);
+        }
+        Chain& keep = chains[a];
+        const Chain gone = chains[b];
+        keep.edges |= gone.edges;
+        if (gone.low < keep.low) {
+            keep.low = gone.low;
+            keep.lowTip = gone.lowTip;
+        }
+        if (gone.high > keep.high) {
+            keep.high = gone.high;
+            keep.highTip = gone.highTip;
+        }
+        keep.stones += gone.stones;
+        parent[b] = a;
+        chains.erase(b);
+    }
+};
+
+// Move choice for large boards in time that depends on the stones, not the area. Candidates are the empty cells within
+// bridge distance of the recent moves, of the tips of the longest chains of both players, and of the stones in the
+// most contested tiles. Each is scored by how far it stretches the player's chain along its direction when joined to
+// the adjacent and bridge-linked chains, plus the same measure for the opponent (taking the opponent's best point).
+class LargeBoardPlayer {
+private:
+    Player player;
+    Player opponent;
+    Xoroshiro128Plus rng;
+
+    static const int recentMoves = 8;    // latest moves whose surroundings are always candidates
+    static const int longestChains = 8;  // chains per player whose tips are candidates
+    static const int contestedTiles = 4; // tiles with the most stones in contact
+
+public:
+    LargeBoardPlayer(Player player, std::uint64_t seed)
+        : player(player), opponent(player == Player::BLUE ? Player::RED : Player::BLUE), rng(seed) {}
+
+    Player getPlayer() const {
+        return player;
+    }
+
+    std::pair<long long, long long> getBestMove(TiledBoard& board) {
+        const long long size = board.getSize();
+        std::vector<long long> candidates = listCandidates(board);
+        if (candidates.empty()) return fallbackMove(board);
+
+        long long best = candidates[0];
+        double bestScore = -1e300;
+        for (long long candidate : candidates) {
+            const long long x = candidate / size, y = candidate % size;
+            double own = stretch(board, player, x, y);
+            double block = stretch(board, opponent, x, y);
+            // Small random tie-break so equal scores do not always favour the lowest cell
+            double score = own + 0.6 * block + 1e-3 * static_cast<double>(rng.bounded(1000));
+            if (score > bestScore) {
+                bestScore = score;
+                best = candidate;
+            }
+        }
+        return {best / size, best % size};
+    }
+
+    // Empty cells within distance two of the anchors
+    std::vector<long long> listCandidates(TiledBoard& board) {
+        const long long size = board.getSize();
+        std::vector<long long> anchors;
+        const std::vector<long long>& history = board.getHistory();
+        const size_t recent = static_cast<size_t>(recentMoves);
+        for (size_t i = history.size() > recent ? history.size() - recent : 0; i < history.size(); ++i) {
+            anchors.push_back(history[i]);
+        }
+        for (Player side : {player, opponent}) {
+            std::vector<std::pair<int, long long>> spans;
+            for (const auto& entry : board.allChains()) {
+                if (board.at(entry.first / size, entry.first % size) == side) {
+                    spans.push_back({entry.second.high - entry.second.low, entry.first});
+                }
+            }
+            size_t keep = std::min<size_t>(spans.size(), longestChains);
+            std::partial_sort(spans.begin(), spans.begin() + keep, spans.end(),
+                              [](const std::pair<int, long long>& a, const std::pair<int, long long>& b) {
+                                  return a.first > b.first || (a.first == b.first && a.second < b.second);
+                              });
+            for (size_t i = 0; i < keep; ++i) {
+                const TiledBoard::Chain& chain = board.allChains().at(spans[i].second);
+                anchors.push_back(chain.lowTip);
+                anchors.push_back(chain.highTip);
+            }
+        }
+        std::vector<std::pair<int, long long>> contested;
+        for (const auto& entry : board.allTiles()) {
+            if (entry.second.contacts > 0) contested.push_back({entry.second.contacts, entry.first});
+        }
+        size_t keep = std::min<size_t>(contested.size(), contestedTiles);
+        std::partial_sort(contested.begin(), contested.begin() + keep, contested.end(),
+                          [](const std::pair<int, long long>& a, const std::pair<int, long long>& b) {
+                              return a.first > b.first || (a.first == b.first && a.second < b.second);
+                          });
+        const int side = TiledBoard::tileSide;
+        for (size_t i = 0; i < keep; ++i) {
+            const TiledBoard::Tile& tile = board.allTiles().at(contested[i].second);
+            const std::pair<long long, long long> origin = board.tileOrigin(contested[i].second);
+            for (int bit = 0; bit < side * side; ++bit) {
+                if (((tile.stones[0] | tile.stones[1]) >> bit) & 1) {
+                    anchors.push_back((origin.first + bit / side) * size + origin.second + bit % side);
+                }
+            }
+        }
+
+        // Hex distance two: the six neighbours, the six bridge cells and the six cells two steps straight out
+        static const int reach[18][2] = {{-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0},
+                                         {-2, 1}, {-1, 2}, {1, 1}, {2, -1}, {1, -2}, {-1, -1},
+                                         {-2, 0}, {-2, 2}, {0, 2}, {2, 0}, {2, -2}, {0, -2}};
+        std::vector<long long> candidates;
+        for (long long anchor : anchors) {
+            const long long x = anchor / size, y = anchor % size;
+            for (const auto& offset : reach) {
+                long long nx = x + offset[0], ny = y + offset[1];
+                if (board.isValidMove(nx, ny)) candidates.push_back(nx * size + ny);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+        return candidates;
+    }
+
+private:
+    // Every anchor is boxed in: the centre if free, else random probes and finally a scan for an empty cell
+    std::pair<long long, long long> fallbackMove(const TiledBoard& board) {
+        const long long size = board.getSize();
+        if (board.isValidMove(size / 2, size / 2)) return {size / 2, size / 2};
+        for (int probe = 0; probe < 64; ++probe) {
+            long long x = static_cast<long long>(rng() % static_cast<std::uint64_t>(size));
+            long long y = static_cast<long long>(rng() % static_cast<std::uint64_t>(size));
+            if (board.isValidMove(x, y)) return {x, y};
+        }
+        for (long long x = 0; x < size; ++x) {
+            for (long long y = 0; y < size; ++y) {
+                if (board.isValidMove(x, y)) return {x, y};
+            }
+        }
+        return {-1, -1};
+    }
+
+    // Growth of the side's longest extent if it played (x, y): the cell joins the adjacent chains and those linked by
+    // an intact bridge. Joining both edges is a win and scores above everything else.
+    static double stretch(TiledBoard& board, Player side, long long x, long long y) {
+        static const int bridges[6][4] = {{-2, 1, -1, 0}, {-1, 2, -1, 1}, {1, 1, 0, 1},
+                                          {2, -1, 1, -1}, {1, -2, 1, -1}, {-1, -1, 0, -1}}; // far cell, then one carrier
+        const long long size = board.getSize();
+        std::vector<long long> roots;
+        board.forNeighbours(x, y, [&](long long nx, long long ny) {
+            if (board.at(nx, ny) == side) roots.push_back(board.find(nx * size + ny));
+        });
+        for (const auto& bridge : bridges) {
+            long long fx = x + bridge[0], fy = y + bridge[1];
+            long long ax = x + bridge[2], ay = y + bridge[3];
+            long long bx = fx - bridge[2], by = fy - bridge[3]; // the other common neighbour of (x, y) and the far cell
+            if (!board.inside(fx, fy) || board.at(fx, fy) != side) continue;
+            if (board.isValidMove(ax, ay) && board.isValidMove(bx, by)) roots.push_back(board.find(fx * size + fy));
+        }
+        const long long line = board.axis(side, x, y);
+        long long low = line, high = line, longest = 0;
+        int edges = (line == 0 ? 1 : 0) | (line == size - 1 ? 2 : 0);
+        std::sort(roots.begin(), roots.end());
+        roots.erase(std::unique(roots.begin(), roots.end()), roots.end());
+        for (long long root : roots) {
+            const TiledBoard::Chain& chain = board.chainOf(root);
+            low = std::min<long long>(low, chain.low);
+            high = std::max<long long>(high, chain.high);
+            longest = std::max<long long>(longest, chain.high - chain.low);
+            edges |= chain.edges;
+        }
+        if (edges == 3) return 1e9;
+        return static_cast<double>(high - low - longest) + 0.5 * static_cast<double>(roots.size());
+    }
+};
+
+// Engine-versus-engine game on a large board, reporting time per move and memory
+void runLargeSelfPlay(long long size, std::uint64_t seed) {
+    TiledBoard board(size, BluePath::LEFT_TO_RIGHT);
+    LargeBoardPlayer blue(Player::BLUE, seed), red(Player::RED, seed ^ 0x9E3779B97F4A7C15ULL);
+    Player toMove = Player::BLUE;
+    auto start = std::chrono::steady_clock::now();
+    long long moves = 0;
+    while (board.getWinner() == Player::BLANK && moves < size * size) {
+        LargeBoardPlayer& engine = toMove == Player::BLUE ? blue : red;
+        std::pair<long long, long long> move = engine.getBestMove(board);
+        board.makeMove(move.first, move.second, toMove);
+        ++moves;
+        toMove = toMove == Player::BLUE ? Player::RED : Player::BLUE;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const long long last = board.getHistory().back();
+    std::cout << board.window(last / size - 12, last % size - 12, 24);
+    std::cout << size << "x" << size << ": " << (board.getWinner() == Player::BLUE ? "BLUE" : "RED") << " wins after "
+              << moves << " moves, " << std::fixed << std::setprecision(3) << 1e3 * seconds / moves << " ms per move, "
+              << board.allTiles().size() << " tiles, " << board.memoryBytes() / 1024 << " KiB" << std::defaultfloat
+              << std::endl;
+}
+
+// Cross-check of TiledBoard against the plain Board. Games on sizes 20, 23, ... between two seeded large-board
+// engines, with one move in three random, are mirrored onto a Board; after every move both must agree on the winner,
+// and at the end each tile's contact count must match a recount over the whole board. Returns false on any difference.
+bool checkLargeBoard(int games, std::uint64_t seed) {
+    int failures = 0;
+    long long totalMoves = 0;
+    for (int game = 0; game < games; ++game) {
+        const int size = 20 + 3 * game;
+        const BluePath bluePath = game % 2 ? BluePath::LEFT_TO_RIGHT : BluePath::TOP_TO_BOTTOM;
+        TiledBoard tiled(size, bluePath);
+        Board board(size);
+        LargeBoardPlayer blue(Player::BLUE, seed + game), red(Player::RED, seed + game + 100);
+        Xoroshiro128Plus rng(seed + game);
+        Player toMove = Player::BLUE;
+        bool agreed = true;
+        while (agreed && tiled.getWinner() == Player::BLANK) {
+            std::pair<long long, long long> move;
+            if (rng.bounded(3) == 0) {
+                do {
+                    move = {rng.bounded(size), rng.bounded(size)};
+                } while (!tiled.isValidMove(move.first, move.second));
+            } else {
+                move = (toMove == Player::BLUE ? blue : red).getBestMove(tiled);
+            }
+            if (!tiled.isValidMove(move.first, move.second)) {
+                std::cout << "game " << game << ": engine chose the invalid move (" << move.first << ", "
+                          << move.second << ")" << std::endl;
+                agreed = false;
+                break;
+            }
+            tiled.makeMove(move.first, move.second, toMove);
+            board.makeMove(static_cast<int>(move.first), static_cast<int>(move.second), toMove);
+            ++totalMoves;
+            if (board.hasWinner(toMove, bluePath) != (tiled.getWinner() == toMove)) {
+                std::cout << "game " << game << ": winner differs after move " << tiled.getHistory().size()
+                          << std::endl;
+                agreed = false;
+            }
+            toMove = toMove == Player::BLUE ? Player::RED : Player::BLUE;
+        }
+
+        long long counted = 0, expected = 0;
+        for (const auto& entry : tiled.allTiles()) counted += entry.second.contacts;
+        for (long long x = 0; x < size; ++x) {
+            for (long long y = 0; y < size; ++y) {
+                const Player stone = tiled.at(x, y);
+                if (stone == Player::BLANK) continue;
+                bool contact = false;
+                tiled.forNeighbours(x, y, [&](long long nx, long long ny) {
+                    const Player other = tiled.at(nx, ny);
+                    if (other != Player::BLANK && other != stone) contact = true;
+                });
+                if (contact) ++expected;
+            }
+        }
+        if (counted != expected) {
+            std::cout << "game " << game << ": tiles count " << counted << " contacts, the board has " << expected
+                      << std::endl;
+            agreed = false;
+        }
+        if (!agreed) ++failures;
+    }
+    std::cout << "Large board check: " << games << " games, " << totalMoves << " moves, " << failures
+              << " with differences" << std::endl;
+    return failures == 0;
+}
+
+// Human against the large-board engine; shows the area around the latest move
+class LargeBoardGame {
+private:
+    TiledBoard board;
+    LargeBoardPlayer engine;
+
+public:
+    LargeBoardGame(long long size, Player userPlayer, std::uint64_t seed)
+        : board(size, BluePath::LEFT_TO_RIGHT), engine(userPlayer == Player::BLUE ? Player::RED : Player::BLUE, seed) {
+        std::cout << "Large board " << size << "x" << size << " against the heuristic large-board engine: BLUE joins "
+                  << "left and right, RED top and bottom" << std::endl;
+    }
+
+    void play() {
+        Player currentPlayer = Player::BLUE;
+        const long long size = board.getSize();
+        while (board.getWinner() == Player::BLANK) {
+            if (currentPlayer == engine.getPlayer()) {
+                std::pair<long long, long long> move = engine.getBestMove(board);
+                board.makeMove(move.first, move.second, currentPlayer);
+                std::cout << "AI Player " << (currentPlayer == Player::BLUE ? "BLUE" : "RED") << " makes move ("
+                          << move.first << ", " << move.second << ")" << std::endl;
             } else {
-                std::pair<int, int> bestMove = aiPlayer.getBestMove(board, bluePath);
-                board.makeMove(bestMove.first, bestMove.second, currentPlayer);
-                moveCount++;
-                std::cout << "AI Player " << (currentPlayer == Player::BLUE ? "BLUE" : "RED")
-                          << " makes move (" << bestMove.first << ", " << bestMove.second << ")" << std::endl;
+                long long x, y;
+                std::cout << "Player " << (currentPlayer == Player::BLUE ? "BLUE" : "RED") << ", enter your move (x y): ";
+                std::cin >> x >> y;
+                if (std::cin.fail()) {
+                    if (std::cin.eof()) return;
+                    std::cin.clear();
+                    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                    std::cerr << "Invalid input. Please enter numeric coordinates." << std::endl;
+                    continue;
+                }
+                if (!board.isValidMove(x, y)) {
+                    std::cerr << "Invalid move. The coordinate is preoccupied or out of bounds. Try again." << std::endl;
+                    continue;
+                }
+                board.makeMove(x, y, currentPlayer);
+            }
+            const long long last = board.getHistory().back();
+            std::string frame = board.window(last / size - 8, last % size - 8, 16);
+            std::cout.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+            currentPlayer = currentPlayer == Player::BLUE ? Player::RED : Player::BLUE;
+        }
+        std::cout << "Player " << (board.getWinner() == Player::BLUE ? "BLUE" : "RED") << " wins!" << std::endl;
+    }
+};
 
-                if (board.hasWinner(currentPlayer, bluePath)) {
-                    board.display();
-                    std::cout << "Player " << (currentPlayer == Player::BLUE ? "BLUE" : "RED")
-                              << " wins!" << std::endl;
-                    return;
+//Batch Analysis: streams positions from a file and evaluates them on a worker pool with bounded memory
+struct BatchPosition {
+    long long index;
+    Board board;
+    BluePath bluePath;
+    Player toMove;
+    std::pair<int, int> played; // move actually played from this position in an archive, {-1, -1} otherwise
+};
+
+// Blocking FIFO with a fixed capacity; push waits while the queue is full
+template <typename T>
+class BoundedQueue {
+private:
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+    std::mutex mutex;
+    std::condition_variable notEmpty, notFull;
+
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity), closed(false) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return items.size() < capacity; });
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+    }
+
+    // Returns false once the queue is closed and drained
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+    }
+};
+
+// Parses "<size> <L|T> <B|R> <cells>" where cells lists size*size characters of '.', 'B' and 'R' row by row;
+// L/T is Blue's path and B/R the side to move
+bool parsePositionLine(const std::string& line, BatchPosition& position) {
+    std::istringstream in(line);
+    int size;
+    char path, side;
+    std::string cells;
+    if (!(in >> size >> path >> side >> cells) || size < 1 || size > 64 ||
+        cells.size() != static_cast<size_t>(size * size)) {
+        return false;
+    }
+    position.board = Board(size);
+    position.bluePath = (path == 'T' || path == 't') ? BluePath::TOP_TO_BOTTOM : BluePath::LEFT_TO_RIGHT;
+    position.toMove = (side == 'R' || side == 'r') ? Player::RED : Player::BLUE;
+    position.played = {-1, -1};
+    for (int i = 0; i < size * size; ++i) {
+        if (cells[i] == 'B' || cells[i] == 'b') position.board.makeMove(i / size, i % size, Player::BLUE);
+        else if (cells[i] == 'R' || cells[i] == 'r') position.board.makeMove(i / size, i % size, Player::RED);
+        else if (cells[i] != '.') return false;
+    }
+    return true;
+}
+
+class BatchAnalyzer {
+private:
+    int threads;
+    int trials;
+    std::uint64_t seed;
+    std::ostream& out;
+    // Engine options, applied to every position's engine
+    AIPlayer::Playouts playouts;
+    bool vcs;
+    bool paired;
+    const PatternPriors* priors;       // not owned
+    const PositionDatabase* positions; // not owned
+    BoundedQueue<BatchPosition> queue;
+    size_t window;                          // max positions read but not yet written
+    std::mutex outputMutex;
+    std::condition_variable outputProgress;
+    std::map<long long, std::string> pending; // finished results waiting for earlier ones
+    long long nextToWrite;
+
+public:
+    BatchAnalyzer(int threads, int trials, std::uint64_t seed, std::ostream& out)
+        : threads(threads), trials(trials), seed(seed), out(out), playouts(AIPlayer::Playouts::RANDOM), vcs(false),
+          paired(false), priors(nullptr), positions(nullptr), queue(2 * threads),
+          window(4 * static_cast<size_t>(threads)), nextToWrite(0) {}
+
+    void setPlayouts(AIPlayer::Playouts policy) {
+        playouts = policy;
+    }
+
+    void setVirtualConnections(bool enabled) {
+        vcs = enabled;
+    }
+
+    void setPairedTrials(bool enabled) {
+        paired = enabled;
+    }
+
+    void setPriors(const PatternPriors* table) {
+        priors = table;
+    }
+
+    void setPositionDatabase(const PositionDatabase* database) {
+        positions = database;
+    }
+
+    // Streams positions from a text position file or a game-record archive; results are written in input order
+    long long run(const std::string& inputPath) {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([this] { work(); });
+        }
+
+        long long count = 0;
+        std::ifstream probe(inputPath, std::ios::binary);
+        char magic[4] = {0, 0, 0, 0};
+        probe.read(magic, 4);
+        probe.close();
+
+        if (std::memcmp(magic, "HEXG", 4) == 0) {
+            GameRecordReader reader(inputPath);
+            GameView game;
+            while (reader.next(game)) {
+                int size = game.header->boardSize;
+                BatchPosition position{0, Board(size), static_cast<BluePath>(game.header->bluePath), Player::BLUE, {-1, -1}};
+                for (int i = 0; i < game.header->moveCount; ++i) {
+                    position.index = count++;
+                    position.played = game.move(i);
+                    submit(position);
+                    const std::pair<int, int> stone = game.stone(i);
+                    position.board.makeMove(stone.first, stone.second, game.colour(i));
+                    position.toMove = game.colour(i) == Player::BLUE ? Player::RED : Player::BLUE;
+                }
+            }
+        } else {
+            std::ifstream in(inputPath);
+            std::string line;
+            while (std::getline(in, line)) {
+                if (line.empty() || line[0] == '#') continue;
+                BatchPosition position{0, Board(1), BluePath::LEFT_TO_RIGHT, Player::BLUE, {-1, -1}};
+                if (!parsePositionLine(line, position)) {
+                    std::cerr << "Skipping malformed position: " << line << std::endl;
+                    continue;
                 }
+                position.index = count++;
+                submit(std::move(position));
+            }
+        }
 
-                currentPlayer = (currentPlayer == Player::BLUE) ? Player::RED : Player::BLUE;
+        queue.close();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        return count;
+    }
+
+private:
+    void submit(BatchPosition position) {
+        {
+            std::unique_lock<std::mutex> lock(outputMutex);
+            outputProgress.wait(lock, [&] { return position.index - nextToWrite < static_cast<long long>(window); });
+        }
+        queue.push(std::move(position));
+    }
+
+    void work() {
+        BatchPosition position{0, Board(1), BluePath::LEFT_TO_RIGHT, Player::BLUE, {-1, -1}};
+        while (queue.pop(position)) {
+            std::uint64_t state = seed + static_cast<std::uint64_t>(position.index);
+            AIPlayer engine(position.toMove, splitMix64(state));
+            engine.setPlayouts(playouts);
+            engine.setVirtualConnections(vcs);
+            engine.setPairedTrials(paired);
+            engine.setPriors(priors);
+            engine.setPositionDatabase(positions);
+            std::vector<AIPlayer::CandidateStats> candidates =
+                engine.analyzePosition(position.board, position.bluePath, trials);
+            std::string result = format(position, candidates);
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            pending.emplace(position.index, std::move(result));
+            while (!pending.empty() && pending.begin()->first == nextToWrite) {
+                out << pending.begin()->second;
+                pending.erase(pending.begin());
+                ++nextToWrite;
             }
+            out.flush();
+            outputProgress.notify_all();
+        }
+    }
 
-            if (checkDraw(moveCount)) {
-                std::cout << "Game over! It's a draw!" << std::endl;
+    static std::string format(const BatchPosition& position, const std::vector<AIPlayer::CandidateStats>& candidates) {
+        std::ostringstream line;
+        line << position.index;
+        if (candidates.empty()) {
+            line << " no-moves\n";
+            return line.str();
+        }
+        size_t best = AIPlayer::bestCandidate(candidates);
+        line << " best " << candidates[best].move.first << " " << candidates[best].move.second << std::fixed
+             << std::setprecision(4) << " winrate " << candidates[best].winRate() << " confidence "
+             << AIPlayer::confidence(candidates, best);
+        if (position.played.first >= 0) {
+            line << " played " << position.played.first << " " << position.played.second;
+        }
+        line << " candidates";
+        for (const AIPlayer::CandidateStats& candidate : candidates) {
+            line << " " << candidate.move.first << "," << candidate.move.second << ":" << candidate.winRate();
+        }
+        line << "\n";
+        return line.str();
+    }
+};
+
+// Uses a perfect-play table as an oracle: over up to `limit` won positions, how often does the Monte Carlo engine pick a
+// move that keeps the win?
+int runOracle(const std::string& path, long long limit, int trials, std::uint64_t seed) {
+    PerfectPlayTable table(path);
+    if (!table.isOpen()) {
+        std::cerr << "Cannot open table " << path << std::endl;
+        return 1;
+    }
+    const int size = table.boardSize();
+    SmallBoardSolver solver(size);
+    long long tested = 0, kept = 0;
+    for (std::uint64_t index = 0; index < table.slotCount() && tested < limit; ++index) {
+        std::uint64_t key;
+        std::uint8_t info;
+        if (!table.slot(index, key, info) || !(info & 0x80)) continue;
+
+        Board board(size);
+        std::uint64_t blue = 0, red = 0;
+        for (int cell = 0; cell < size * size; ++cell, key /= 3) {
+            if (key % 3 == 1) {
+                board.makeMove(cell / size, cell % size, Player::BLUE);
+                blue |= SmallBoardSolver::cellBit(cell);
+            } else if (key % 3 == 2) {
+                board.makeMove(cell / size, cell % size, Player::RED);
+                red |= SmallBoardSolver::cellBit(cell);
+            }
+        }
+        const bool blueMoves = SmallBoardSolver::blueToMove(blue, red);
+        AIPlayer engine(blueMoves ? Player::BLUE : Player::RED, seed);
+        std::vector<AIPlayer::CandidateStats> candidates = engine.analyze(board, BluePath::LEFT_TO_RIGHT, trials);
+        std::pair<int, int> move = candidates[AIPlayer::bestCandidate(candidates)].move;
+        std::uint64_t bit = SmallBoardSolver::cellBit(move.first * size + move.second);
+        int reply;
+        bool stillWon = blueMoves ? (solver.connects(blue | bit, true) || !solver.solve(blue | bit, red, reply))
+                                  : (solver.connects(red | bit, false) || !solver.solve(blue, red | bit, reply));
+        ++tested;
+        if (stillWon) ++kept;
+    }
+    std::cout << "Engine kept the win in " << kept << " of " << tested << " won positions ("
+              << std::fixed << std::setprecision(1) << (tested ? 100.0 * kept / tested : 0.0) << "%)" << std::endl;
+    return 0;
+}
+
+// Prints every game in a record archive, one line per game
+int dumpRecords(const std::string& path) {
+    GameRecordReader reader(path);
+    if (!reader.isOpen()) {
+        std::cerr << "Cannot open record file " << path << std::endl;
+        return 1;
+    }
+    GameView game;
+    int games = 0;
+    while (reader.next(game)) {
+        const GameRecordHeader& header = *game.header;
+        std::cout << "game " << games++ << ": " << static_cast<int>(header.boardSize) << "x"
+                  << static_cast<int>(header.boardSize) << " seed " << header.seed << " winner "
+                  << (header.winner == 0 ? "BLUE" : header.winner == 1 ? "RED" : "none") << " moves";
+        for (int i = 0; i < header.moveCount; ++i) {
+            std::pair<int, int> move = game.move(i);
+            std::cout << " " << move.first << "," << move.second;
+            if (i == 0 && (header.flags & RECORD_SWAPPED)) std::cout << " swap";
+            if (game.stats && game.stats[i].playouts > 0) {
+                std::cout << "[" << std::fixed << std::setprecision(2) << game.stats[i].winRate / 65535.0 << "]";
+            }
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+//Engine Server: many concurrent games in one process over localhost TCP
+// Line protocol, one command per line:
+//   new <size> <L|T> <B|R> [ms]  human colour and per-move budget -> "game <id>" (the AI moves first if the human is RED)
+//   play <id> <x> <y>            human move -> "ok <id>", later "move <id> <x> <y>" once the engine has replied
+//   close <id>                   -> "closed <id>"
+//   stats                        -> "games <n> searching <m> workers <w>"
+//   shutdown                     stops the server
+// "over <id> BLUE|RED" follows the move that ends a game; bad commands answer "error <text>".
+#ifdef _WIN32
+typedef SOCKET SocketHandle;
+typedef WSAPOLLFD PollEntry;
+static const SocketHandle invalidSocket = INVALID_SOCKET;
+inline void closeSocket(SocketHandle socket) {
+    closesocket(socket);
+}
+inline int pollSockets(PollEntry* entries, size_t count, int millis) {
+    return WSAPoll(entries, static_cast<ULONG>(count), millis);
+}
+inline void setNonBlocking(SocketHandle socket) {
+    u_long enabled = 1;
+    ioctlsocket(socket, FIONBIO, &enabled);
+}
+inline bool wouldBlock() {
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+#else
+typedef int SocketHandle;
+typedef pollfd PollEntry;
+static const SocketHandle invalidSocket = -1;
+inline void closeSocket(SocketHandle socket) {
+    close(socket);
+}
+inline int pollSockets(PollEntry* entries, size_t count, int millis) {
+    return poll(entries, static_cast<nfds_t>(count), millis);
+}
+inline void setNonBlocking(SocketHandle socket) {
+    fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+}
+inline bool wouldBlock() {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+#endif
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Keeps the calling thread on one CPU so a worker's playout state stays in that core's cache
+inline void pinCurrentThread(unsigned cpu) {
+#if defined(_WIN32)
+    SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << (cpu % (8 * sizeof(DWORD_PTR))));
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+// One engine search of a served game; a worker owns it only while running one slice
+struct SearchJob {
+    int gameId;
+    Board board;
+    BluePath bluePath;
+    AIPlayer engine;
+    std::vector<AIPlayer::CandidateStats> candidates;
+    size_t cursor;  // next candidate to advance
+    bool wrapped;   // every candidate has had its first trial
+    int trials;     // target trials per candidate
+    std::chrono::steady_clock::time_point deadline;
+    std::atomic<bool> cancelled;
+    std::pair<int, int> result;
+
+    SearchJob(int gameId, const Board& board, BluePath bluePath, const AIPlayer& engine, int trials, int millis)
+        : gameId(gameId), board(board), bluePath(bluePath), engine(engine),
+          candidates(engine.seededCandidates(board, bluePath)), cursor(0), wrapped(false), trials(trials),
+          deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(millis)), cancelled(false),
+          result(-1, -1) {}
+};
+
+// Shared search workers, one per CPU. Jobs wait in one FIFO queue and go back to its tail after each slice, so every
+// searching game advances in turn however many games are running.
+class SearchPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::shared_ptr<SearchJob>> queue;
+    std::vector<std::shared_ptr<SearchJob>> finished;
+    bool stopping;
+
+    static const int sliceTrials = 8;      // trials per candidate in one slice
+    static const int sliceCandidates = 16; // candidates advanced in one slice
+
+public:
+    explicit SearchPool(int threads) : stopping(false) {
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back(&SearchPool::run, this, static_cast<unsigned>(t));
+        }
+    }
+
+    ~SearchPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        ready.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    SearchPool(const SearchPool&) = delete;
+    SearchPool& operator=(const SearchPool&) = delete;
+
+    int size() const {
+        return static_cast<int>(workers.size());
+    }
+
+    void submit(const std::shared_ptr<SearchJob>& job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(job);
+        }
+        ready.notify_one();
+    }
+
+    // Jobs completed since the last call
+    std::vector<std::shared_ptr<SearchJob>> collect() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::shared_ptr<SearchJob>> done;
+        done.swap(finished);
+        return done;
+    }
+
+private:
+    void run(unsigned index) {
+        pinCurrentThread(index % std::max(1u, std::thread::hardware_concurrency()));
+        while (true) {
+            std::shared_ptr<SearchJob> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [&] { return stopping || !queue.empty(); });
+                if (stopping) return;
+                job = queue.front();
+                queue.pop_front();
+            }
+            if (job->cancelled) continue;
+            bool done = runSlice(*job);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (done) {
+                finished.push_back(job);
+            } else {
+                queue.push_back(job);
+            }
+        }
+    }
+
+    // Advances the next few candidates; true once every candidate has its trials or the move budget has run out.
+    // The first pass gives each candidate a single trial so that even a short budget sees every move.
+    static bool runSlice(SearchJob& job) {
+        const size_t count = job.candidates.size();
+        bool complete = true;
+        for (int step = 0; step < sliceCandidates && count > 0; ++step) {
+            AIPlayer::CandidateStats& stats = job.candidates[job.cursor];
+            int remaining = job.trials - stats.trials;
+            if (remaining > 0) {
+                job.engine.addTrials(job.board, job.bluePath, job.cursor, stats,
+                                     std::min(job.wrapped ? sliceTrials : 1, remaining));
+            }
+            if (++job.cursor == count) {
+                job.cursor = 0;
+                job.wrapped = true;
+            }
+        }
+        for (const AIPlayer::CandidateStats& stats : job.candidates) {
+            if (stats.trials < job.trials) {
+                complete = false;
                 break;
             }
         }
+        if (!complete && std::chrono::steady_clock::now() < job.deadline) {
+            return false;
+        }
+        if (count > 0) {
+            job.result = job.candidates[AIPlayer::bestCandidate(job.candidates)].move;
+        }
+        return true;
     }
+};
 
+class EngineServer {
 private:
-    void askUserPath() {
-        int choice;
-        std::cout << "Player RED, choose your path:\n";
-        std::cout << "1. Left to Right\n";
-        std::cout << "2. Top to Bottom\n";
-        std::cout << "Enter your choice (1 or 2): ";
-        std::cin >> choice;
+    struct ServedGame {
+        SocketHandle client;
+        Board board;
+        BluePath bluePath;
+        Player human;
+        AIPlayer engine;
+        int moveMillis;
+        bool over;
+        std::shared_ptr<SearchJob> search; // running engine search, if any
+    };
 
-        if (choice == 1) {
-            bluePath = BluePath::TOP_TO_BOTTOM;
-        } else if (choice == 2) {
-            bluePath = BluePath::LEFT_TO_RIGHT;
+    // Client sockets are non-blocking: replies queue here and go out as the socket accepts them, so a client that
+    // stops reading holds up only its own games
+    struct Connection {
+        std::string input;  // received, not yet a whole line
+        std::string output; // queued, not yet sent
+    };
+
+    static const size_t maxPendingOutput = 1 << 20; // a client this far behind is dropped
+
+    SearchPool pool;
+    // Shared by every game and resident for the life of the server, not owned
+    const PerfectPlayTable* table;
+    const PatternPriors* priors;
+    const PositionDatabase* positions;
+    const FirstMoveTable* openings;
+    std::uint64_t seed;
+    int trials;
+    int defaultMillis;
+    std::map<SocketHandle, Connection> connections;
+    std::map<int, ServedGame> games;
+    int nextGameId;
+    bool running;
+
+public:
+    EngineServer(int threads, int trials, int moveMillis, std::uint64_t seed, const PerfectPlayTable* table,
+                 const PatternPriors* priors, const PositionDatabase* positions, const FirstMoveTable* openings)
+        : pool(threads), table(table), priors(priors), positions(positions), openings(openings), seed(seed),
+          trials(trials), defaultMillis(moveMillis), nextGameId(1), running(false) {}
+
+    // Serves 127.0.0.1:<port> until a client sends "shutdown"; returns the process exit code
+    int run(int port) {
+#ifdef _WIN32
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+            std::cerr << "Cannot start Winsock" << std::endl;
+            return 1;
+        }
+#endif
+        SocketHandle listener = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+        sockaddr_in address = sockaddr_in();
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<unsigned short>(port));
+        if (listener == invalidSocket || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listener, 64) != 0) {
+            std::cerr << "Cannot listen on port " << port << std::endl;
+            if (listener != invalidSocket) closeSocket(listener);
+            return 1;
+        }
+        std::cout << "Serving on 127.0.0.1:" << port << " with " << pool.size() << " search workers" << std::endl;
+
+        running = true;
+        std::vector<PollEntry> entries;
+        while (running) {
+            // poll has no descriptor limit, unlike select; the short timeout answers finished searches promptly
+            entries.clear();
+            entries.push_back(PollEntry());
+            entries.back().fd = listener;
+            entries.back().events = POLLIN;
+            for (const auto& connection : connections) {
+                entries.push_back(PollEntry());
+                entries.back().fd = connection.first;
+                entries.back().events = static_cast<short>(POLLIN | (connection.second.output.empty() ? 0 : POLLOUT));
+            }
+            int ready = pollSockets(entries.data(), entries.size(), 5);
+
+            if (ready > 0 && (entries[0].revents & POLLIN)) {
+                SocketHandle client = accept(listener, nullptr, nullptr);
+                if (client != invalidSocket) {
+                    setNonBlocking(client);
+                    connections[client];
+                }
+            }
+            for (size_t i = 1; ready > 0 && i < entries.size(); ++i) {
+                if (entries[i].revents & (POLLIN | POLLERR | POLLHUP)) {
+                    receive(entries[i].fd);
+                }
+            }
+            for (const std::shared_ptr<SearchJob>& job : pool.collect()) {
+                finishSearch(*job);
+            }
+            flushAll();
+        }
+
+        for (const auto& connection : connections) {
+            closeSocket(connection.first);
+        }
+        closeSocket(listener);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return 0;
+    }
+
+private:
+    void sendLine(SocketHandle client, const std::string& text) {
+        auto it = connections.find(client);
+        if (it == connections.end()) return;
+        it->second.output += text;
+        it->second.output += '\n';
+    }
+
+    // Sends what each socket takes without waiting; drops clients that fail or fall too far behind
+    void flushAll() {
+        std::vector<SocketHandle> dropped;
+        for (auto& connection : connections) {
+            std::string& output = connection.second.output;
+            size_t sent = 0;
+            while (sent < output.size()) {
+                int written = send(connection.first, output.data() + sent, static_cast<int>(output.size() - sent),
+                                   MSG_NOSIGNAL);
+                if (written <= 0) {
+                    if (written < 0 && wouldBlock()) break;
+                    dropped.push_back(connection.first);
+                    break;
+                }
+                sent += static_cast<size_t>(written);
+            }
+            output.erase(0, sent);
+            if (output.size() > maxPendingOutput) dropped.push_back(connection.first);
+        }
+        for (SocketHandle client : dropped) {
+            if (connections.count(client)) disconnect(client);
+        }
+    }
+
+    static const char* colourName(Player player) {
+        return player == Player::BLUE ? "BLUE" : "RED";
+    }
+
+    void receive(SocketHandle client) {
+        if (connections.find(client) == connections.end()) return; // dropped earlier in this round
+        char buffer[4096];
+        int received = recv(client, buffer, sizeof(buffer), 0);
+        if (received < 0 && wouldBlock()) return;
+        if (received <= 0) {
+            disconnect(client);
+            return;
+        }
+        std::string& input = connections[client].input;
+        input.append(buffer, static_cast<size_t>(received));
+        size_t end;
+        while ((end = input.find('\n')) != std::string::npos) {
+            std::string line = input.substr(0, end);
+            input.erase(0, end + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty()) handle(client, line);
+            if (connections.find(client) == connections.end()) return;
+        }
+    }
+
+    void disconnect(SocketHandle client) {
+        for (auto it = games.begin(); it != games.end();) {
+            if (it->second.client == client) {
+                if (it->second.search) it->second.search->cancelled = true;
+                it = games.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        connections.erase(client);
+        closeSocket(client);
+    }
+
+    void handle(SocketHandle client, const std::string& line) {
+        std::istringstream in(line);
+        std::string command;
+        in >> command;
+        if (command == "new") {
+            int size = 0, millis = defaultMillis;
+            char path = 0, colour = 0;
+            in >> size >> path >> colour;
+            if (!in || size < 2 || size > 26 || (path != 'L' && path != 'T') || (colour != 'B' && colour != 'R')) {
+                sendLine(client, "error usage: new <size> <L|T> <B|R> [ms]");
+                return;
+            }
+            if (!(in >> millis)) millis = defaultMillis;
+            const int id = nextGameId++;
+            const Player human = colour == 'B' ? Player::BLUE : Player::RED;
+            std::uint64_t state = seed + static_cast<std::uint64_t>(id);
+            AIPlayer engine(human == Player::BLUE ? Player::RED : Player::BLUE, splitMix64(state));
+            engine.setTable(table);
+            engine.setPriors(priors);
+            engine.setPositionDatabase(positions);
+            ServedGame game{client, Board(size), path == 'L' ? BluePath::LEFT_TO_RIGHT : BluePath::TOP_TO_BOTTOM,
+                            human, engine, std::max(1, millis), false, nullptr};
+            ServedGame& served = games.emplace(id, std::move(game)).first->second;
+            sendLine(client, "game " + std::to_string(id));
+            if (human == Player::RED) startSearch(id, served);
+        } else if (command == "play") {
+            int id = 0, x = -1, y = -1;
+            in >> id >> x >> y;
+            auto it = games.find(id);
+            if (!in || it == games.end() || it->second.client != client) {
+                sendLine(client, "error unknown game");
+                return;
+            }
+            ServedGame& game = it->second;
+            if (game.over || game.search) {
+                sendLine(client, "error not your turn");
+                return;
+            }
+            if (!game.board.isValidMove(x, y)) {
+                sendLine(client, "error invalid move");
+                return;
+            }
+            game.board.makeMove(x, y, game.human);
+            sendLine(client, "ok " + std::to_string(id));
+            if (game.board.hasWinner(game.human, game.bluePath)) {
+                game.over = true;
+                sendLine(client, "over " + std::to_string(id) + " " + colourName(game.human));
+            } else {
+                startSearch(id, game);
+            }
+        } else if (command == "close") {
+            int id = 0;
+            in >> id;
+            auto it = games.find(id);
+            if (it == games.end() || it->second.client != client) {
+                sendLine(client, "error unknown game");
+                return;
+            }
+            if (it->second.search) it->second.search->cancelled = true;
+            games.erase(it);
+            sendLine(client, "closed " + std::to_string(id));
+        } else if (command == "stats") {
+            int searching = 0;
+            for (const auto& game : games) {
+                if (game.second.search) ++searching;
+            }
+            sendLine(client, "games " + std::to_string(games.size()) + " searching " + std::to_string(searching) +
+                                 " workers " + std::to_string(pool.size()));
+        } else if (command == "shutdown") {
+            running = false;
         } else {
-            std::cerr << "Invalid choice. Defaulting to Top to Bottom." << std::endl;
-            bluePath = BluePath::TOP_TO_BOTTOM;
+            sendLine(client, "error unknown command");
+        }
+    }
+
+    // Answers from the shared tables at once, otherwise queues a search with this game's move budget. Games here are
+    // played without the swap rule, so the opening table gives the strongest first move.
+    void startSearch(int id, ServedGame& game) {
+        bool wins;
+        std::pair<int, int> perfect;
+        if (openings != nullptr && game.board.stonesPlaced() == 0 && openings->boardSize() == game.board.getSize()) {
+            playEngineMove(id, game, openings->strongestOpening(game.bluePath));
+            return;
+        }
+        if (table != nullptr && table->lookup(game.board, game.bluePath, game.engine.getPlayer(), wins, perfect)) {
+            playEngineMove(id, game, perfect);
+            return;
+        }
+        game.search = std::make_shared<SearchJob>(id, game.board, game.bluePath, game.engine, trials, game.moveMillis);
+        pool.submit(game.search);
+    }
+
+    void finishSearch(const SearchJob& job) {
+        auto it = games.find(job.gameId);
+        if (job.cancelled || it == games.end() || it->second.search.get() != &job) return; // game closed meanwhile
+        it->second.search.reset();
+        playEngineMove(job.gameId, it->second, job.result);
+    }
+
+    void playEngineMove(int id, ServedGame& game, std::pair<int, int> move) {
+        const Player ai = game.engine.getPlayer();
+        if (move.first < 0) {
+            game.over = true; // full board, nothing left to play
+            sendLine(game.client, "over " + std::to_string(id) + " none");
+            return;
+        }
+        game.board.makeMove(move.first, move.second, ai);
+        sendLine(game.client, "move " + std::to_string(id) + " " + std::to_string(move.first) + " " +
+                                  std::to_string(move.second));
+        if (game.board.hasWinner(ai, game.bluePath)) {
+            game.over = true;
+            sendLine(game.client, "over " + std::to_string(id) + " " + colourName(ai));
         }
     }
 };
 
-int main() {
+int main(int argc, char* argv[]) {
     int size = 11;//User can change size of board  
+    std::uint64_t seed = RandomStreams::clockSeed();
+    std::string recordPath;
+    std::string batchInput, batchOutput;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int trials = AIPlayer::simulations;
+    bool ponder = false;
+    bool vcs = false;
+    bool pairedTrials = false;
+    bool large = false; // AI games use the heuristic large-board engine
+    std::string tablePath;
+    std::string priorsPath;
+    bool swapRule = false;
+    std::string openingsPath;
+    std::string databasePath;
+    int servePort = 0;
+    int moveMillis = 120000; // per-move budget of served games
+    double clockSeconds = 0.0, incrementSeconds = 0.0; // AI game clock, 0 = fixed trials per move
+    AIPlayer::Level level = AIPlayer::Level::MONTE_CARLO;
+    AIPlayer::Playouts playouts = AIPlayer::Playouts::RANDOM;
+    BoardRenderer::Mode renderMode = BoardRenderer::Mode::FULL;
+    //Command line options
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--record" && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (arg == "--dump-records" && i + 1 < argc) {
+            return dumpRecords(argv[i + 1]);
+        } else if (arg == "--batch" && i + 2 < argc) {
+            batchInput = argv[++i];
+            batchOutput = argv[++i];
+        } else if (arg == "--table" && i + 1 < argc) {
+            tablePath = argv[++i];
+        } else if (arg == "--priors" && i + 1 < argc) {
+            priorsPath = argv[++i];
+        } else if (arg == "--position-db" && i + 1 < argc) {
+            databasePath = argv[++i];
+        } else if (arg == "--build-db" && i + 2 < argc) {
+            return buildPositionDatabase(argv[i + 1], argv[i + 2]) < 0 ? 1 : 0;
+        } else if (arg == "--bench-db" && i + 2 < argc) {
+            benchPositionDatabase(argv[i + 1], argv[i + 2]);
+            return 0;
+        } else if (arg == "--swap") {
+            swapRule = true;
+        } else if (arg == "--openings" && i + 1 < argc) {
+            openingsPath = argv[++i];
+        } else if (arg == "--build-openings" && i + 2 < argc) {
+            int openingSize = std::atoi(argv[i + 1]);
+            if (openingSize < 2 || openingSize > 19) {
+                std::cerr << "Opening tables support boards from 2x2 to 19x19" << std::endl;
+                return 1;
+            }
+            return buildFirstMoveTable(openingSize, trials, threads, seed, argv[i + 2]) ? 0 : 1;
+        } else if (arg == "--train-priors" && i + 2 < argc) {
+            int iterations = i + 3 < argc ? std::max(1, std::atoi(argv[i + 3])) : 30;
+            return trainPatternPriors(argv[i + 1], argv[i + 2], iterations) < 0 ? 1 : 0;
+        } else if (arg == "--solve" && i + 3 < argc) {
+            int solveSize = std::atoi(argv[i + 1]);
+            if (solveSize < 1 || solveSize > SmallBoardSolver::maxSize) {
+                std::cerr << "Perfect-play tables support boards up to " << SmallBoardSolver::maxSize << "x"
+                          << SmallBoardSolver::maxSize << std::endl;
+                return 1;
+            }
+            long long stored = buildPerfectTable(solveSize, std::atoi(argv[i + 2]), argv[i + 3]);
+            std::cout << "Stored " << stored << " positions in " << argv[i + 3] << std::endl;
+            return stored < 0 ? 1 : 0;
+        } else if (arg == "--oracle" && i + 2 < argc) {
+            return runOracle(argv[i + 1], std::atoll(argv[i + 2]), trials, seed);
+        } else if (arg == "--serve" && i + 1 < argc) {
+            servePort = std::atoi(argv[++i]);
+        } else if (arg == "--move-ms" && i + 1 < argc) {
+            moveMillis = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--bench-resistance") {
+            benchResistance(11, seed);
+            benchResistance(19, seed);
+            return 0;
+        } else if (arg == "--clock" && i + 1 < argc) {
+            clockSeconds = std::atof(argv[++i]);
+        } else if (arg == "--increment" && i + 1 < argc) {
+            incrementSeconds = std::atof(argv[++i]);
+        } else if (arg == "--level" && i + 1 < argc) {
+            std::string name = argv[++i];
+            level = name == "heuristic" ? AIPlayer::Level::HEURISTIC : AIPlayer::Level::MONTE_CARLO;
+        } else if (arg == "--playouts" && i + 1 < argc) {
+            std::string name = argv[++i];
+            playouts = name == "heuristic" ? AIPlayer::Playouts::HEURISTIC : AIPlayer::Playouts::RANDOM;
+        } else if (arg == "--render" && i + 1 < argc) {
+            std::string name = argv[++i];
+            renderMode = name == "diff" ? BoardRenderer::Mode::DIFF
+                         : name == "quiet" ? BoardRenderer::Mode::QUIET : BoardRenderer::Mode::FULL;
+        } else if (arg == "--ponder") {
+            ponder = true;
+        } else if (arg == "--vc") {
+            vcs = true;
+        } else if (arg == "--paired") {
+            pairedTrials = true;
+        } else if (arg == "--size" && i + 1 < argc) {
+            size = std::max(2, std::atoi(argv[++i]));
+        } else if (arg == "--large") {
+            large = true;
+        } else if (arg == "--selfplay-large" && i + 1 < argc) {
+            runLargeSelfPlay(std::max(2LL, std::atoll(argv[i + 1])), seed);
+            return 0;
+        } else if (arg == "--check-large") {
+            return checkLargeBoard(20, seed) ? 0 : 1;
+        } else if (arg == "--bench-variance") {
+            benchVariance(11, seed);
+            return 0;
+        } else if (arg == "--check-vcs") {
+            bool sound = checkVirtualConnections(5, 20, seed);
+            sound = checkVirtualConnections(7, 20, seed) && sound;
+            return sound ? 0 : 1;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--trials" && i + 1 < argc) {
+            trials = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (large) {
+        // The large-board engine has its own board and heuristic player; none of these reach it
+        std::vector<std::string> unsupported;
+        if (!recordPath.empty()) unsupported.push_back("--record");
+        if (swapRule) unsupported.push_back("--swap");
+        if (!tablePath.empty()) unsupported.push_back("--table");
+        if (!openingsPath.empty()) unsupported.push_back("--openings");
+        if (ponder) unsupported.push_back("--ponder");
+        if (clockSeconds > 0.0) unsupported.push_back("--clock");
+        if (!priorsPath.empty()) unsupported.push_back("--priors");
+        if (!databasePath.empty()) unsupported.push_back("--position-db");
+        if (vcs) unsupported.push_back("--vc");
+        if (pairedTrials) unsupported.push_back("--paired");
+        if (level != AIPlayer::Level::MONTE_CARLO) unsupported.push_back("--level");
+        if (playouts != AIPlayer::Playouts::RANDOM) unsupported.push_back("--playouts");
+        if (renderMode != BoardRenderer::Mode::FULL) unsupported.push_back("--render");
+        if (servePort > 0) unsupported.push_back("--serve");
+        if (!batchInput.empty()) unsupported.push_back("--batch");
+        if (!unsupported.empty()) {
+            std::cerr << "--large does not support";
+            for (const std::string& option : unsupported) {
+                std::cerr << " " << option;
+            }
+            std::cerr << std::endl;
+            return 1;
+        }
+    }
+
+    if (!batchInput.empty()) {
+        // Batch analysis reports every candidate's statistics, which the table and the heuristic level do not have
+        std::vector<std::string> unsupported;
+        if (!tablePath.empty()) unsupported.push_back("--table");
+        if (level != AIPlayer::Level::MONTE_CARLO) unsupported.push_back("--level");
+        if (clockSeconds > 0.0) unsupported.push_back("--clock");
+        if (ponder) unsupported.push_back("--ponder");
+        if (swapRule) unsupported.push_back("--swap");
+        if (!openingsPath.empty()) unsupported.push_back("--openings");
+        if (!recordPath.empty()) unsupported.push_back("--record");
+        if (servePort > 0) unsupported.push_back("--serve");
+        if (!unsupported.empty()) {
+            std::cerr << "--batch does not support";
+            for (const std::string& option : unsupported) {
+                std::cerr << " " << option;
+            }
+            std::cerr << std::endl;
+            return 1;
+        }
+    }
+
+    PerfectPlayTable* table = nullptr;
+    if (!tablePath.empty()) {
+        table = new PerfectPlayTable(tablePath);
+        if (!table->isOpen()) {
+            std::cerr << "Cannot open table " << tablePath << std::endl;
+            return 1;
+        }
+    }
+
+    PatternPriors* priors = nullptr;
+    if (!priorsPath.empty()) {
+        priors = new PatternPriors(priorsPath);
+        if (!priors->isOpen()) {
+            std::cerr << "Cannot open prior table " << priorsPath << std::endl;
+            delete priors;
+            delete table;
+            return 1;
+        }
+    }
+
+    FirstMoveTable* openings = nullptr;
+    if (!openingsPath.empty()) {
+        openings = new FirstMoveTable(openingsPath);
+        if (!openings->isOpen()) {
+            std::cerr << "Cannot open opening table " << openingsPath << std::endl;
+            delete openings;
+            delete priors;
+            delete table;
+            return 1;
+        }
+    }
+
+    PositionDatabase* database = nullptr;
+    if (!databasePath.empty()) {
+        database = new PositionDatabase(databasePath);
+        if (!database->isOpen()) {
+            std::cerr << "Cannot open position database " << databasePath << std::endl;
+            delete database;
+            delete openings;
+            delete priors;
+            delete table;
+            return 1;
+        }
+    }
+
+    if (!batchInput.empty()) {
+        int status = 0;
+        std::ofstream results(batchOutput);
+        if (!results) {
+            std::cerr << "Cannot open output file " << batchOutput << std::endl;
+            status = 1;
+        } else {
+            BatchAnalyzer analyzer(threads, trials, seed, results);
+            analyzer.setPlayouts(playouts);
+            analyzer.setVirtualConnections(vcs);
+            analyzer.setPairedTrials(pairedTrials);
+            analyzer.setPriors(priors);
+            analyzer.setPositionDatabase(database);
+            long long positions = analyzer.run(batchInput);
+            std::cout << "Analyzed " << positions << " positions" << std::endl;
+        }
+        delete table;
+        delete priors;
+        delete openings;
+        delete database;
+        return status;
+    }
+
+    if (servePort > 0) {
+        int status;
+        {
+            EngineServer server(threads, trials, moveMillis, seed, table, priors, database, openings);
+            status = server.run(servePort);
+        }
+        delete table;
+        delete priors;
+        delete openings;
+        delete database;
+        return status;
+    }
+
+    GameRecordWriter* recorder = nullptr;
+    if (!recordPath.empty()) {
+        recorder = new GameRecordWriter(recordPath);
+        if (!recorder->isOpen()) {
+            std::cerr << "Cannot open record file " << recordPath << std::endl;
+            return 1;
+        }
+    }
+
     char gameType;
     std::cout << "Choose game type:\n";
     std::cout << "1. Manual Game\n";
@@ -425,19 +5418,54 @@ int main() {
     std::cout << "Enter your choice (1 or 2): ";
     std::cin >> gameType;
 
-    if (gameType == '1') {
+    if (gameType == '1' && large) {
+        std::cerr << "--large only applies to AI games" << std::endl;
+    } else if (gameType == '1') {
         ManualGame game(size);
+        game.setRecorder(recorder);
+        game.setSwapRule(swapRule);
+        game.setRenderMode(renderMode);
         game.play();
     } else if (gameType == '2') {
         char userColor;
         std::cout << "Choose your color (B for Blue, R for Red): ";
         std::cin >> userColor;
         Player userPlayer = (userColor == 'B' || userColor == 'b') ? Player::BLUE : Player::RED;
-        AIGame game(size, userPlayer);
+        if (large) {
+            LargeBoardGame game(size, userPlayer, seed);
+            game.play();
+            delete recorder;
+            delete table;
+            delete priors;
+            delete openings;
+            delete database;
+            return 0;
+        }
+        AIGame game(size, userPlayer, seed);
+        game.setRecorder(recorder);
+        game.setPondering(ponder);
+        game.setTable(table);
+        if (clockSeconds > 0.0) {
+            game.setClock(clockSeconds, incrementSeconds);
+        }
+        game.setRenderMode(renderMode);
+        game.setLevel(level);
+        game.setPlayouts(playouts);
+        game.setVirtualConnections(vcs);
+        game.setPairedTrials(pairedTrials);
+        game.setPriors(priors);
+        game.setSwapRule(swapRule);
+        game.setFirstMoveTable(openings);
+        game.setPositionDatabase(database);
         game.play();
     } else {
         std::cerr << "Invalid choice." << std::endl;
     }
 
+    delete recorder;
+    delete table;
+    delete priors;
+    delete openings;
+    delete database;
     return 0;
 }
\ No newline at end of file
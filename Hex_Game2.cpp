@@ -4,6 +4,7 @@
 #include <iostream>
 #include <vector>
 #include <set>
+#include <sstream>
 
 using namespace std;
 
@@ -219,27 +220,30 @@ class AsciiBoard:public Board
     public:
     AsciiBoard(int bSize):Board(bSize){}
     void draw(){
+        //build the whole frame first so it goes out in one write
+        ostringstream frame;
         int shiftNo = 0;
         for(int i = 0;  i < boardSize - 1 ; i++){
-            shiftLine(shiftNo++);
-            printLine(i);
-            shiftLine(shiftNo++);
-            printInline();
+            shiftLine(frame, shiftNo++);
+            printLine(frame, i);
+            shiftLine(frame, shiftNo++);
+            printInline(frame);
         }
-        shiftLine(shiftNo);
-        printLine(boardSize-1);
+        shiftLine(frame, shiftNo);
+        printLine(frame, boardSize-1);
+        cout << frame.str() << flush;
     }
 
     private:
-    void printLine(int lineNo){
+    void printLine(ostream& out, int lineNo){
         for(int i = 0; i < boardSize-1; i++){
-            cout << getSymbol(board[lineNo][i]) << " - ";
+            out << getSymbol(board[lineNo][i]) << " - ";
         }
-        cout << getSymbol(board[lineNo][boardSize-1]) << endl;
+        out << getSymbol(board[lineNo][boardSize-1]) << '\n';
     }
-    void shiftLine(int numSpace){
+    void shiftLine(ostream& out, int numSpace){
         for(int i = 0; i < numSpace; i++){
-            cout << " ";
+            out << " ";
         }
     }
 
@@ -259,11 +263,11 @@ class AsciiBoard:public Board
         }
 
     }
-    void printInline(){
+    void printInline(ostream& out){
         for(int i = 0; i < boardSize - 1; i++){
-            cout << "\\ / " ;
+            out << "\\ / " ;
         }
-        cout << "\\" << endl;
+        out << "\\" << '\n';
     }
 };
 
@@ -4,6 +4,7 @@
 #include <iomanip>
 #include <functional> 
 #include <limits> // for std::numeric_limits
+#include <sstream>
 
 enum class Player : short { BLUE, RED, BLANK }; // Enum for players
 enum class BluePath : short { LEFT_TO_RIGHT, TOP_TO_BOTTOM }; // Enum for blue path options
@@ -45,19 +46,21 @@ public:
     }
  
     void display() const {
+        // Build the whole frame first so it goes out in one write
+        std::ostringstream frame;
         // Print column coordinates
-        std::cout << "  ";
+        frame << "  ";
         for (int col = 0; col < size; ++col) {
-            std::cout << "  " << col << " ";
+            frame << "  " << col << " ";
         }
-        std::cout << std::endl;
+        frame << '\n';
 
         for (int row = 0; row < size; ++row) {
             // Print leading spaces for the staggered effect
-            std::cout << std::string(row * 2, ' ');
+            frame << std::string(row * 2, ' ');
 
             // Print row position
-            std::cout << row << " ";
+            frame << row << " ";
 
             // Print the grid contents
             for (int col = 0; col < size; ++col) {
@@ -67,24 +70,25 @@ public:
                     case Player::RED: ch = 'R'; break;
                     default: ch = '.'; break;
                 }
-                std::cout << ch;
+                frame << ch;
 
                 // Add a dash between columns, except for the last column
                 if (col < size - 1) {
-                    std::cout << " - ";
+                    frame << " - ";
                 }
             }
-            std::cout << std::endl;
+            frame << '\n';
 
             // Print the slashes between rows, except for the last row
             if (row < size - 1) {
-                std::cout << std::string(row * 2 + 1, ' ') << " \\ /";
+                frame << std::string(row * 2 + 1, ' ') << " \\ /";
                 for (int k = 1; k < size; ++k) {
-                    std::cout << " \\ /";
+                    frame << " \\ /";
                 }
-                std::cout << std::endl;
+                frame << '\n';
             }
         }
+        std::cout << frame.str() << std::flush;
     }
 
     // Check if the given player has won using the specified blue path
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <sstream>
 #include <queue>
 #include <utility>
 #include <ctime>
@@ -51,23 +52,26 @@ private:
 
 void BoardGraph::printBoardGraph()
 {
+	// build the whole frame first so it goes out in one write
+	ostringstream frame;
 	// first line
-	cout << board[0][0];
+	frame << board[0][0];
 	for (int j=1; j<size; j++)
-		cout << " - " << board[0][j];
-	cout << endl;
+		frame << " - " << board[0][j];
+	frame << '\n';
 
 	string space = "";
 	for (int i=1; i<size; i++)
 	{
 		space += ' ';
-		cout << space << edges << endl;
+		frame << space << edges << '\n';
 		space += ' ';
-		cout << space << board[i][0];
+		frame << space << board[i][0];
 		for (int j=1; j<size; j++)
-			cout << " - " << board[i][j];
-		cout << endl;
+			frame << " - " << board[i][j];
+		frame << '\n';
 	}
+	cout << frame.str() << flush;
 }
 
 bool BoardGraph::ValidMove(int x, int y)